@@ -8,9 +8,51 @@
 #define JSON_H
 
 #include <stdio.h>
+#include <stddef.h>
 
 typedef struct json json;
-typedef struct {int line, column;} json_error;
+typedef struct json_parser json_parser;
+typedef struct json_lines json_lines;
+typedef struct json_items json_items;
+typedef struct json_map json_map;
+
+enum json_error_code
+{
+    JSON_ERROR_NONE,
+    JSON_ERROR_SYNTAX,
+    /* Limits of json_options */
+    JSON_ERROR_DEPTH,
+    JSON_ERROR_NODES,
+    JSON_ERROR_STRING,
+    JSON_ERROR_BYTES,
+    /* Binding, the value doesn't match the type of the member */
+    JSON_ERROR_TYPE,
+    /* Name repeated in an object (JSON_PARSE_UNIQUE) */
+    JSON_ERROR_DUPLICATE,
+    /* Readers, the stream could not be read (errno is set) */
+    JSON_ERROR_READ,
+};
+
+/*
+ * offset is the number of bytes before the error, line and column are 0
+ * until json_error_locate is called (or set by the line readers)
+ */
+typedef struct
+{
+    size_t offset, line, column;
+    enum json_error_code code;
+} json_error;
+
+typedef struct
+{
+    unsigned flags;
+    /* Limits, 0 means no limit */
+    size_t max_depth;   // Nesting of objects and arrays
+    size_t max_nodes;   // Elements of the document
+    size_t max_string;  // Bytes of a name or a string in the text
+    size_t max_bytes;   // Size of the text
+} json_options;
+typedef struct {const char *text, *end, *name;} json_cursor;
 typedef int (*json_callback)(const json *, int, void *);
 typedef int (*json_compare)(const json *, const json *);
 
@@ -108,6 +150,88 @@ enum json_query
     arrayOfUniqueNulls,
 };
 
+enum json_event
+{
+    JSON_EVENT_START_OBJECT,
+    JSON_EVENT_END_OBJECT,
+    JSON_EVENT_START_ARRAY,
+    JSON_EVENT_END_ARRAY,
+    JSON_EVENT_KEY,
+    JSON_EVENT_STRING,
+    JSON_EVENT_NUMBER,
+    JSON_EVENT_BOOLEAN,
+    JSON_EVENT_NULL,
+};
+
+typedef int (*json_event_callback)(enum json_event, const json *, void *);
+
+enum json_ingest_flags
+{
+    /* Records are delivered in the same order than the input */
+    JSON_INGEST_ORDERED = 1 << 0,
+};
+
+typedef struct {unsigned threads, flags;} json_ingest_options;
+typedef int (*json_ingest_callback)(const json *, const json_error *, void *);
+
+/* Type of a member of a C struct bound to json */
+enum json_bind_type
+{
+    JSON_BIND_INTEGER,  // Signed integer of 1, 2, 4 or 8 bytes
+    JSON_BIND_UNSIGNED, // Unsigned integer of 1, 2, 4 or 8 bytes
+    JSON_BIND_DOUBLE,   // float or double
+    JSON_BIND_BOOLEAN,  // Integer or _Bool (0 or 1)
+    JSON_BIND_STRING,   // char * allocated by json_bind
+    JSON_BIND_CHARS,    // Array of char, the string must fit
+    JSON_BIND_OBJECT,   // Nested struct described by fields
+    JSON_BIND_ARRAY,    // Array of fixed size, fields describes an element
+};
+
+/* Member of a C struct, a list of members ends with a NULL name */
+typedef struct json_field
+{
+    const char *name;
+    enum json_bind_type type;
+    size_t offset, size;
+    /* Members of a nested struct or element of an array */
+    const struct json_field *fields;
+    /* Offset of the size_t with the number of elements of an array */
+    size_t count;
+} json_field;
+
+#define JSON_BIND_SIZE(type, member) sizeof(((type *)0)->member)
+/* The json name is the name of the member */
+#define JSON_FIELD(type, member, kind) \
+    {#member, kind, offsetof(type, member), JSON_BIND_SIZE(type, member), \
+     NULL, 0}
+#define JSON_FIELD_OBJECT(type, member, members) \
+    {#member, JSON_BIND_OBJECT, offsetof(type, member), \
+     JSON_BIND_SIZE(type, member), members, 0}
+#define JSON_FIELD_ARRAY(type, member, element, counter) \
+    {#member, JSON_BIND_ARRAY, offsetof(type, member), \
+     JSON_BIND_SIZE(type, member), element, offsetof(type, counter)}
+/* Element of an array (members is NULL unless kind is JSON_BIND_OBJECT) */
+#define JSON_ELEMENT(type, kind, members) \
+    {NULL, kind, 0, sizeof(type), members, 0}
+#define JSON_FIELD_END {NULL, JSON_BIND_INTEGER, 0, 0, NULL, 0}
+
+enum json_parse_flags
+{
+    /* Nodes, names and strings are allocated in a single arena */
+    JSON_PARSE_ARENA = 1 << 0,
+    /* Identical names share a single copy (implies JSON_PARSE_ARENA) */
+    JSON_PARSE_INTERN = 1 << 1,
+    /* Names and strings must be well-formed UTF-8 */
+    JSON_PARSE_UTF8 = 1 << 2,
+    /* Doubles keep their text, converted when read and written verbatim */
+    JSON_PARSE_LAZY = 1 << 3,
+    /* Repeated names in an object are an error */
+    JSON_PARSE_UNIQUE = 1 << 4,
+    /* Repeated names in an object keep the first or the last member */
+    JSON_PARSE_KEEP_FIRST = 1 << 5,
+    JSON_PARSE_KEEP_LAST = 1 << 6,
+};
+
 // ============================================================================
 // Builder
 // ============================================================================
@@ -144,9 +268,46 @@ void json_free(json *);
 // Parser
 // ============================================================================
 json *json_parse(const char *, json_error *);
+json *json_parse_options(const char *, const json_options *, json_error *);
+json *json_parse_insitu(char *, const json_options *, json_error *);
 json *json_parse_file(const char *, json_error *);
+json *json_parse_file_options(const char *, const json_options *,
+    json_error *);
+json_parser *json_parser_create(const json_options *);
+int json_parser_feed(json_parser *, const char *, size_t);
+json *json_parser_finish(json_parser *, json_error *);
+void json_parser_destroy(json_parser *);
+int json_parse_events(const char *, json_event_callback, void *, json_error *);
+int json_valid(const char *, size_t, json_error *);
+json *json_parse_projection(const char *, size_t, const char **, size_t,
+    json_error *);
+json_lines *json_lines_open(FILE *);
+json *json_lines_read(json_lines *, json_error *);
+size_t json_lines_record(const json_lines *);
+void json_lines_close(json_lines *);
+json_items *json_items_open(FILE *);
+json_items *json_items_open_fd(int);
+json *json_items_read(json_items *, json_error *);
+size_t json_items_count(const json_items *);
+void json_items_close(json_items *);
+int json_ingest(const char *, size_t, const json_ingest_options *,
+    json_ingest_callback, void *);
+int json_ingest_file(const char *, const json_ingest_options *,
+    json_ingest_callback, void *);
+json_map *json_parse_files(const char **, size_t,
+    const json_ingest_options *, json_error *);
+json *json_parse_parallel(const char *, const json_options *, unsigned,
+    json_error *);
+json *json_parse_file_parallel(const char *, unsigned, json_error *);
+void json_error_locate(json_error *, const char *);
 void json_print_error(const char *, const json_error *);
 // ============================================================================
+// Binding
+// ============================================================================
+int json_bind(const char *, const json_field *, void *, json_error *);
+char *json_bind_encode(const json_field *, const void *);
+void json_bind_free(const json_field *, void *);
+// ============================================================================
 // Reader
 // ============================================================================
 enum json_type json_type(const json *);
@@ -191,11 +352,26 @@ int json_depth(const json *);
 int json_equal(const json *, const json *);
 int json_traverse(const json *, json_callback, void *);
 // ============================================================================
+// Cursor
+// ============================================================================
+int json_cursor_init(json_cursor *, const char *, size_t);
+enum json_type json_cursor_type(const json_cursor *);
+int json_cursor_child(const json_cursor *, json_cursor *);
+int json_cursor_next(json_cursor *);
+int json_cursor_find(const json_cursor *, const char *, json_cursor *);
+int json_cursor_at(const json_cursor *, size_t, json_cursor *);
+long long json_cursor_integer(const json_cursor *);
+double json_cursor_double(const json_cursor *);
+double json_cursor_number(const json_cursor *);
+int json_cursor_boolean(const json_cursor *);
+json *json_cursor_value(const json_cursor *);
+// ============================================================================
 // Writer
 // ============================================================================
 char *json_encode(const json *);
 char *json_encode_value(const json *);
 int json_write(const json *, FILE *);
+int json_write_line(const json *, FILE *);
 int json_print(const json *);
 char *json_path(const json *);
 // ============================================================================
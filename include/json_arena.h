@@ -0,0 +1,45 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include "json_struct.h"
+#include "json_map.h"
+
+typedef struct arena_block arena_block;
+
+/**
+ * A document owns the memory of all the nodes, names and strings
+ * allocated from its arena, the root node is embedded in the document
+ * so that the whole tree is released at once by json_free(root)
+ */
+typedef struct json_arena
+{
+    json root; // Must be the first member
+    arena_block *block;
+    /* Blocks kept by arena_reset() to be used again */
+    arena_block *spare;
+    size_t size;
+    int dirty; // Heap memory was attached to the tree
+    json_map *names; // Interned names (JSON_PARSE_INTERN)
+    /* Documents whose memory is released along with this one */
+    struct json_arena *merged;
+} json_arena;
+
+json_arena *arena_create(size_t);
+json *arena_node(json_arena *);
+char *arena_string(json_arena *, size_t);
+void arena_trim(json_arena *, const char *);
+char *arena_intern(json_arena *, char *);
+char *arena_interned(const json *, const char *);
+int arena_interns(const json *);
+void arena_touch(const json *);
+void arena_merge(json_arena *, json_arena *);
+void arena_reset(json_arena *);
+void arena_destroy(json_arena *);
+
+#endif /* JSON_ARENA_H */
@@ -0,0 +1,26 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#ifndef JSON_FILE_H
+#define JSON_FILE_H
+
+#include <stddef.h>
+
+/**
+ * Contents of a file, mapped in memory when possible or read otherwise,
+ * the text is read-only and it is not NUL terminated
+ */
+typedef struct
+{
+    const char *text;
+    size_t size;
+    int mapped;
+} json_file;
+
+int file_load(json_file *, const char *);
+void file_release(json_file *);
+
+#endif /* JSON_FILE_H */
@@ -0,0 +1,22 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#ifndef JSON_NUMBER_H
+#define JSON_NUMBER_H
+
+#include "json_struct.h"
+
+/**
+ * Validates and converts the json number from str to end (excluded)
+ * storing its type and value in node, returns 0 if the text is not a
+ * valid json number
+ * Integers out of the range of int64_t and uint64_t are stored as doubles
+ */
+int number_parse(json *, const char *, const char *);
+/* Same as number_parse but doubles are only validated (value untouched) */
+int number_scan(json *, const char *, const char *);
+
+#endif /* JSON_NUMBER_H */
@@ -0,0 +1,64 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#ifndef JSON_PARSER_H
+#define JSON_PARSER_H
+
+#include "json_arena.h"
+
+/**
+ * Parses the text from str to end (excluded), the text doesn't need to
+ * be NUL terminated
+ */
+json *parser_parse(const char *, const char *, const json_options *,
+    json_error *);
+
+/**
+ * Parses in place a sequence of documents recycling the same arena, the
+ * tree is owned by the arena (released with json_free(&arena->root))
+ */
+json *parser_reuse(json_arena **, char *, const char *, json_error *);
+
+/**
+ * Parses a slice of the elements of a group, the elements are children
+ * of the returned node, moved to the final group by the caller
+ */
+json *parser_slice(enum json_type, const char *, const char *,
+    const json_options *, size_t *);
+
+/* Event parser over a sized text */
+int parser_events(const char *, const char *, json_event_callback, void *,
+    json_error *);
+
+/**
+ * Window of the text of a stream read by parts, the text from head to
+ * length is pending and offset is the number of bytes before the text
+ */
+typedef struct
+{
+    char *text;
+    size_t head, length, size;
+    size_t offset;
+    /* The last read didn't fill the window */
+    int eof;
+} parser_window;
+
+/* Reads up to size bytes (the number read in bytes), returns 0 on fail */
+typedef int (*parser_input)(void *, char *, size_t, size_t *);
+
+/**
+ * Moves the pending text to the start of the window and reads more text
+ * after it (the window grows when it is full), returns 0 at EOF and -1
+ * on fail
+ */
+int parser_fill(parser_window *, parser_input, void *);
+
+/* Helpers shared by the readers */
+void parser_clear_error(json_error *);
+int parser_is_space(char);
+int parser_is_blank(const char *, const char *);
+
+#endif /* JSON_PARSER_H */
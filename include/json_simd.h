@@ -0,0 +1,86 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#ifndef JSON_SIMD_H
+#define JSON_SIMD_H
+
+#include <stdint.h>
+
+#define SIMD_BLOCK_SIZE 64
+
+/**
+ * Structural index of the 64 bytes starting at base, bit n of a mask
+ * is set when base[n] belongs to the class:
+ * space: json whitespace (' ', '\t', '\n', '\r')
+ * delim: whitespace, tokens '{' '}' '[' ']' ':' ',' '\0' and quotes
+ * Bytes past the end of the text are classified as '\0'
+ */
+typedef struct
+{
+    const char *base;
+    uint64_t space, delim;
+} json_block;
+
+void simd_classify(json_block *, const char *, const char *);
+
+/**
+ * Marks of the 64 bytes starting at str, bit n of a mask is set when
+ * str[n] is a quote, a backslash, an opening bracket ('{' '['), a closing
+ * bracket ('}' ']') or a comma, bytes past the end are not marked
+ */
+typedef struct
+{
+    uint64_t quote, escape, open, close, comma;
+} json_marks;
+
+void simd_mark(json_marks *, const char *, const char *);
+
+/**
+ * Returns a pointer to the first quote, backslash or control character
+ * of a string, or end when there are none
+ */
+const char *simd_find_special(const char *, const char *);
+
+/**
+ * Returns a pointer to the first bracket or quote, or end when there are
+ * none
+ */
+const char *simd_find_group(const char *, const char *);
+
+/* Number of trailing zeros (mask can not be 0) */
+static inline unsigned simd_ctz(uint64_t mask)
+{
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(mask);
+#else
+    unsigned count = 0;
+
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+/* Number of bits set */
+static inline unsigned simd_popcount(uint64_t mask)
+{
+#if defined(__GNUC__)
+    return (unsigned)__builtin_popcountll(mask);
+#else
+    unsigned count = 0;
+
+    for (; mask != 0; mask &= mask - 1)
+    {
+        count++;
+    }
+    return count;
+#endif
+}
+
+#endif /* JSON_SIMD_H */
@@ -7,12 +7,28 @@
 #ifndef JSON_STRUCT_H
 #define JSON_STRUCT_H
 
+#include <stdint.h>
 #include "json.h"
 
+/* Ownership of the memory and representation of the value of a node */
+enum json_flags
+{
+    JSON_DOCUMENT = 1 << 0,         // Root node embedded in a json_arena
+    JSON_ARENA_NODE = 1 << 1,       // Node allocated from an arena
+    JSON_SHARED_NAME = 1 << 2,      // Name not owned by the node
+    JSON_SHARED_STRING = 1 << 3,    // String not owned by the node
+    JSON_UNSIGNED = 1 << 4,         // Integer greater than INT64_MAX
+    JSON_INTERNED_NAME = 1 << 5,    // Name shared by the whole document
+    JSON_NUMBER_TEXT = 1 << 6,      // Number kept as text in value.string
+    JSON_DUPLICATE = 1 << 7,        // Member dropped once parsed
+};
+
 union json_value
 {
     char *string;
     double number;
+    int64_t integer;
+    uint64_t real;
 };
 
 struct json
@@ -21,7 +37,7 @@ struct json
     char *name;
     union json_value value;
     enum json_type type;
+    unsigned flags;
 };
 
 #endif /* JSON_STRUCT_H */
-
@@ -0,0 +1,18 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#ifndef JSON_UTF8_H
+#define JSON_UTF8_H
+
+#include <stddef.h>
+
+/* Returns a pointer to the first malformed sequence or end if valid */
+const char *utf8_validate(const char *, const char *);
+
+/* Number of code points of a valid text */
+size_t utf8_length(const char *, size_t);
+
+#endif /* JSON_UTF8_H */
@@ -0,0 +1,299 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "json_arena.h"
+
+#define ARENA_MIN_SIZE 256
+#define ARENA_MAX_SIZE (1024 * 1024)
+
+struct arena_block
+{
+    arena_block *next;
+    char *ptr, *end;
+};
+
+static arena_block *block_init(arena_block *block, size_t size)
+{
+    block->next = NULL;
+    block->ptr = (char *)(block + 1);
+    block->end = block->ptr + size;
+    return block;
+}
+
+/* The first block is allocated in the same chunk than the document */
+static arena_block *first_block(const json_arena *arena)
+{
+    return (arena_block *)(uintptr_t)(arena + 1);
+}
+
+json_arena *arena_create(size_t size)
+{
+    if (size < ARENA_MIN_SIZE)
+    {
+        size = ARENA_MIN_SIZE;
+    }
+    if (size > ARENA_MAX_SIZE)
+    {
+        size = ARENA_MAX_SIZE;
+    }
+
+    json_arena *arena = malloc(sizeof *arena + sizeof(arena_block) + size);
+
+    if (arena != NULL)
+    {
+        memset(&arena->root, 0, sizeof arena->root);
+        arena->root.flags = JSON_DOCUMENT;
+        arena->block = block_init(first_block(arena), size);
+        arena->spare = NULL;
+        arena->size = size;
+        arena->dirty = 0;
+        arena->names = NULL;
+        arena->merged = NULL;
+    }
+    return arena;
+}
+
+static size_t block_size(const arena_block *block)
+{
+    return (size_t)(block->end - (const char *)(block + 1));
+}
+
+/* Grows the arena in blocks of increasing size */
+static char *arena_grow(json_arena *arena, size_t size)
+{
+    if (arena->size < ARENA_MAX_SIZE)
+    {
+        arena->size *= 2;
+    }
+
+    size_t room = size > arena->size ? size : arena->size;
+    arena_block *block = arena->spare;
+
+    /* Spare blocks come back in the same order they were allocated */
+    if ((block != NULL) && (block_size(block) >= room))
+    {
+        arena->spare = block->next;
+        block_init(block, block_size(block));
+    }
+    else
+    {
+        block = malloc(sizeof *block + room);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        block_init(block, room);
+    }
+    block->next = arena->block;
+    arena->block = block;
+
+    char *ptr = block->ptr;
+
+    block->ptr += size;
+    return ptr;
+}
+
+static char *arena_alloc(json_arena *arena, size_t size, size_t align)
+{
+    arena_block *block = arena->block;
+    uintptr_t ptr = (uintptr_t)block->ptr;
+
+    ptr = (ptr + (align - 1)) & ~(uintptr_t)(align - 1);
+    if ((ptr <= (uintptr_t)block->end) && (size <= (uintptr_t)block->end - ptr))
+    {
+        block->ptr = (char *)ptr + size;
+        return (char *)ptr;
+    }
+    /* Blocks are aligned to malloc requirements */
+    return arena_grow(arena, size);
+}
+
+json *arena_node(json_arena *arena)
+{
+    json *node = (json *)(void *)arena_alloc(arena,
+        sizeof *node, _Alignof(json)
+    );
+
+    if (node != NULL)
+    {
+        memset(node, 0, sizeof *node);
+        node->flags = JSON_ARENA_NODE;
+    }
+    return node;
+}
+
+char *arena_string(json_arena *arena, size_t size)
+{
+    return arena_alloc(arena, size, 1);
+}
+
+/* Gives back the unused tail of the last allocation (from ptr onwards) */
+void arena_trim(json_arena *arena, const char *ptr)
+{
+    arena_block *block = arena->block;
+
+    if ((ptr >= (const char *)(block + 1)) && (ptr <= block->ptr))
+    {
+        block->ptr = (char *)(uintptr_t)ptr;
+    }
+}
+
+/*
+ * Returns the shared copy of a name just allocated from the arena, the
+ * name is given back when it was already interned
+ */
+char *arena_intern(json_arena *arena, char *name)
+{
+    json *holder = json_map_search(arena->names, name);
+
+    if (holder != NULL)
+    {
+        arena_trim(arena, name);
+        return holder->name;
+    }
+    /* Names are kept in nodes out of the tree */
+    holder = arena_node(arena);
+    if (holder == NULL)
+    {
+        return NULL;
+    }
+    holder->name = name;
+    if (json_map_insert(arena->names, name, holder) != holder)
+    {
+        return NULL;
+    }
+    return name;
+}
+
+static const json_arena *document(const json *node)
+{
+    for (; node != NULL; node = node->parent)
+    {
+        if (node->flags & JSON_DOCUMENT)
+        {
+            return (const json_arena *)(const void *)node;
+        }
+    }
+    return NULL;
+}
+
+/* Returns the interned copy of a name in the document of node or NULL */
+char *arena_interned(const json *node, const char *name)
+{
+    const json_arena *arena = document(node);
+
+    if ((arena == NULL) || (arena->names == NULL))
+    {
+        return NULL;
+    }
+
+    const json *holder = json_map_search(arena->names, name);
+
+    return holder ? holder->name : NULL;
+}
+
+/* Whether the names of the document of node are interned */
+int arena_interns(const json *node)
+{
+    const json_arena *arena = document(node);
+
+    return (arena != NULL) && (arena->names != NULL);
+}
+
+/* Heap memory attached to an arena tree must be released by json_free */
+void arena_touch(const json *node)
+{
+    for (; node != NULL; node = node->parent)
+    {
+        if (node->flags & JSON_DOCUMENT)
+        {
+            ((json_arena *)(uintptr_t)node)->dirty = 1;
+            return;
+        }
+    }
+}
+
+/*
+ * The memory of other (and of the documents merged into it) belongs to
+ * arena from now on, nodes can be moved from one tree to the other
+ */
+void arena_merge(json_arena *arena, json_arena *other)
+{
+    json_arena *last = other;
+
+    while (last->merged != NULL)
+    {
+        last = last->merged;
+    }
+    last->merged = arena->merged;
+    arena->merged = other;
+    arena->dirty |= other->dirty;
+}
+
+static void destroy_merged(json_arena *arena)
+{
+    json_arena *merged = arena->merged;
+
+    while (merged != NULL)
+    {
+        json_arena *next = merged->merged;
+
+        merged->merged = NULL;
+        arena_destroy(merged);
+        merged = next;
+    }
+    arena->merged = NULL;
+}
+
+/* Empties the document keeping its blocks, the tree must not be dirty */
+void arena_reset(json_arena *arena)
+{
+    arena_block *first = first_block(arena);
+    arena_block *block = arena->block;
+
+    while (block != first)
+    {
+        arena_block *next = block->next;
+
+        block->next = arena->spare;
+        arena->spare = block;
+        block = next;
+    }
+    destroy_merged(arena);
+    memset(&arena->root, 0, sizeof arena->root);
+    arena->root.flags = JSON_DOCUMENT;
+    /* Interned names live in the blocks */
+    if (arena->names != NULL)
+    {
+        json_map_destroy(arena->names, NULL);
+        arena->names = json_map_create(0);
+    }
+    arena->block = block_init(first, block_size(first));
+    arena->size = block_size(first);
+}
+
+static void free_blocks(arena_block *block, const arena_block *last)
+{
+    while (block != last)
+    {
+        arena_block *next = block->next;
+
+        free(block);
+        block = next;
+    }
+}
+
+void arena_destroy(json_arena *arena)
+{
+    free_blocks(arena->block, first_block(arena));
+    free_blocks(arena->spare, NULL);
+    json_map_destroy(arena->names, NULL);
+    destroy_merged(arena);
+    free(arena);
+}
@@ -0,0 +1,531 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define _GNU_SOURCE
+#define BATCH_URING
+#endif
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <threads.h>
+#include "json_parser.h"
+#include "json_map.h"
+
+#ifdef BATCH_URING
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+typedef struct
+{
+    const char *path;
+    json *node;
+    json_error error;
+    int done;
+} batch_file;
+
+#ifdef BATCH_URING
+
+/*
+ * The files are opened, measured, read and closed through an io_uring
+ * submission queue, a few system calls are enough for a batch of files
+ */
+
+/* Entries of the queues and files in flight */
+#define BATCH_RING_SIZE 256
+#define BATCH_WINDOW (BATCH_RING_SIZE / 4)
+/* Bytes asked by a single read */
+#define BATCH_READ_SIZE (1024 * 1024 * 1024)
+
+enum {OP_OPEN, OP_STAT, OP_READ, OP_CLOSE, OPS};
+
+typedef struct
+{
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_entries, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_size, cq_size, sqes_size;
+    /* Entries prepared and not submitted, operations not completed */
+    unsigned queued, pending;
+} batch_ring;
+
+/* State of a file in flight */
+typedef struct
+{
+    batch_file *file;
+    struct statx info;
+    char *text;
+    size_t size, length;
+    int fd, waiting, failed;
+} batch_slot;
+
+/* Parses a text read in memory */
+static void batch_parse(batch_file *file, const char *text, size_t size)
+{
+    json_options options = {.flags = JSON_PARSE_ARENA};
+
+    file->node = parser_parse(text, text + size, &options, &file->error);
+    file->done = 1;
+}
+
+static void *ring_map(int fd, size_t size, off_t offset)
+{
+    void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, offset
+    );
+
+    return addr == MAP_FAILED ? NULL : addr;
+}
+
+static void ring_close(batch_ring *ring)
+{
+    if (ring->sqes != NULL)
+    {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if ((ring->cq_ring != NULL) && (ring->cq_ring != ring->sq_ring))
+    {
+        munmap(ring->cq_ring, ring->cq_size);
+    }
+    if (ring->sq_ring != NULL)
+    {
+        munmap(ring->sq_ring, ring->sq_size);
+    }
+    close(ring->fd);
+}
+
+/* Returns 0 when io_uring is not available (old kernel, seccomp) */
+static int ring_open(batch_ring *ring)
+{
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof *ring);
+    memset(&params, 0, sizeof params);
+    ring->fd = (int)syscall(__NR_io_uring_setup, BATCH_RING_SIZE, &params);
+    if (ring->fd < 0)
+    {
+        return 0;
+    }
+    ring->sq_size = params.sq_off.array +
+        params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+    /* Both rings share a single mapping in recent kernels */
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_size > ring->sq_size)
+        {
+            ring->sq_size = ring->cq_size;
+        }
+        ring->cq_size = ring->sq_size;
+    }
+    ring->sq_ring = ring_map(ring->fd, ring->sq_size, IORING_OFF_SQ_RING);
+    ring->cq_ring = params.features & IORING_FEAT_SINGLE_MMAP
+        ? ring->sq_ring
+        : ring_map(ring->fd, ring->cq_size, IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = ring_map(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+    if ((ring->sq_ring == NULL) || (ring->cq_ring == NULL) ||
+        (ring->sqes == NULL))
+    {
+        ring_close(ring);
+        return 0;
+    }
+
+    char *sq = ring->sq_ring, *cq = ring->cq_ring;
+
+    ring->sq_head = (unsigned *)(void *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(void *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(void *)(sq + params.sq_off.ring_mask);
+    ring->sq_entries =
+        (unsigned *)(void *)(sq + params.sq_off.ring_entries);
+    ring->sq_array = (unsigned *)(void *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(void *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(void *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(void *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(void *)(cq + params.cq_off.cqes);
+    return 1;
+}
+
+/* Submits the queued entries and waits for wait completions */
+static int ring_enter(batch_ring *ring, unsigned wait)
+{
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+
+    while (syscall(__NR_io_uring_enter, ring->fd, ring->queued, wait,
+        flags, NULL, 0) < 0)
+    {
+        if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY))
+        {
+            return 0;
+        }
+    }
+    ring->queued = 0;
+    return 1;
+}
+
+/* Returns a clean entry tagged with the slot and the operation */
+static struct io_uring_sqe *ring_entry(batch_ring *ring, size_t slot,
+    unsigned op)
+{
+    unsigned tail = *ring->sq_tail;
+
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) ==
+        *ring->sq_entries)
+    {
+        ring_enter(ring, 0);
+    }
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof *sqe);
+    sqe->user_data = slot * OPS + op;
+    ring->sq_array[index] = index;
+    /* Entries are visible to the kernel after the store of the tail */
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->queued++;
+    ring->pending++;
+    return sqe;
+}
+
+static void submit_open(batch_ring *ring, size_t index, batch_slot *slot)
+{
+    struct io_uring_sqe *sqe = ring_entry(ring, index, OP_OPEN);
+
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uintptr_t)slot->file->path;
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+
+    /* The size is asked at the same time */
+    sqe = ring_entry(ring, index, OP_STAT);
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uintptr_t)slot->file->path;
+    sqe->len = STATX_SIZE | STATX_TYPE;
+    sqe->off = (uintptr_t)&slot->info;
+    slot->fd = -1;
+    slot->waiting = 2;
+    slot->failed = 0;
+}
+
+static void submit_read(batch_ring *ring, size_t index, batch_slot *slot)
+{
+    struct io_uring_sqe *sqe = ring_entry(ring, index, OP_READ);
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = slot->fd;
+    sqe->addr = (uintptr_t)(slot->text + slot->length);
+    sqe->len = slot->size - slot->length > BATCH_READ_SIZE
+        ? BATCH_READ_SIZE
+        : (unsigned)(slot->size - slot->length);
+    sqe->off = slot->length;
+    slot->waiting = 1;
+}
+
+/* The slot is free once the entry is queued */
+static void submit_close(batch_ring *ring, batch_slot *slot)
+{
+    if (slot->fd >= 0)
+    {
+        struct io_uring_sqe *sqe = ring_entry(ring, 0, OP_CLOSE);
+
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = slot->fd;
+        slot->fd = -1;
+    }
+    free(slot->text);
+    slot->text = NULL;
+    slot->file = NULL;
+}
+
+/*
+ * Files that are not regular or that shrink while they are read are left
+ * for the thread pool (read until EOF), also the ones that fail, so that
+ * errno is set as in json_parse_file_options()
+ */
+static void opened(batch_ring *ring, size_t index, batch_slot *slot)
+{
+    if (slot->failed || !S_ISREG(slot->info.stx_mode) ||
+        (slot->info.stx_size == 0) || (slot->info.stx_size > SIZE_MAX))
+    {
+        submit_close(ring, slot);
+        return;
+    }
+    slot->size = (size_t)slot->info.stx_size;
+    slot->length = 0;
+    slot->text = malloc(slot->size);
+    if (slot->text == NULL)
+    {
+        submit_close(ring, slot);
+        return;
+    }
+    submit_read(ring, index, slot);
+}
+
+static void completed(batch_ring *ring, batch_slot *slots,
+    const struct io_uring_cqe *cqe)
+{
+    size_t index = (size_t)(cqe->user_data / OPS);
+    unsigned op = (unsigned)(cqe->user_data % OPS);
+    batch_slot *slot = &slots[index];
+
+    ring->pending--;
+    switch (op)
+    {
+        case OP_OPEN:
+            slot->fd = cqe->res;
+            slot->failed |= cqe->res < 0;
+            break;
+        case OP_STAT:
+            slot->failed |= cqe->res < 0;
+            break;
+        case OP_READ:
+            if (cqe->res > 0)
+            {
+                slot->length += (size_t)cqe->res;
+                if (slot->length < slot->size)
+                {
+                    submit_read(ring, index, slot);
+                    return;
+                }
+                /* Parsed while the other reads are in progress */
+                batch_parse(slot->file, slot->text, slot->size);
+            }
+            submit_close(ring, slot);
+            return;
+        default:
+            return;
+    }
+    if (--slot->waiting == 0)
+    {
+        opened(ring, index, slot);
+    }
+}
+
+/* Does nothing when io_uring is not available */
+static void ring_load(batch_file *files, size_t count)
+{
+    batch_slot *slots = calloc(BATCH_WINDOW, sizeof *slots);
+    batch_ring ring;
+
+    if (slots == NULL)
+    {
+        return;
+    }
+    if (!ring_open(&ring))
+    {
+        free(slots);
+        return;
+    }
+
+    size_t next = 0;
+
+    while (1)
+    {
+        /* Fill the free slots */
+        for (size_t i = 0; (i < BATCH_WINDOW) && (next < count); i++)
+        {
+            if (slots[i].file == NULL)
+            {
+                slots[i].file = &files[next++];
+                submit_open(&ring, i, &slots[i]);
+            }
+        }
+        if (ring.pending == 0)
+        {
+            break;
+        }
+        if (!ring_enter(&ring, 1))
+        {
+            /* The kernel can still write to the slots, leak them */
+            ring_close(&ring);
+            return;
+        }
+
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++)
+        {
+            completed(&ring, slots, &ring.cqes[head & *ring.cq_mask]);
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+    ring_close(&ring);
+    free(slots);
+}
+
+#endif /* BATCH_URING */
+
+typedef struct
+{
+    batch_file *files;
+    size_t count, next;
+    mtx_t mutex;
+} batch_pool;
+
+static int work(void *data)
+{
+    batch_pool *pool = data;
+    /* Same trees than the ones parsed from the ring */
+    json_options options = {.flags = JSON_PARSE_ARENA};
+
+    while (1)
+    {
+        mtx_lock(&pool->mutex);
+
+        size_t next = pool->next;
+
+        while ((next < pool->count) && pool->files[next].done)
+        {
+            next++;
+        }
+        pool->next = next + 1;
+        mtx_unlock(&pool->mutex);
+        if (next >= pool->count)
+        {
+            return 0;
+        }
+
+        batch_file *file = &pool->files[next];
+
+        file->node = json_parse_file_options(file->path, &options,
+            &file->error
+        );
+        file->done = 1;
+    }
+}
+
+/* Loads the files not loaded yet on a pool of threads */
+static int pool_load(batch_file *files, size_t count, unsigned threads)
+{
+    batch_pool pool = {.files = files, .count = count};
+
+    if (mtx_init(&pool.mutex, mtx_plain) != thrd_success)
+    {
+        return 0;
+    }
+
+    size_t size = threads ? threads : 1;
+    thrd_t *list = malloc(size * sizeof *list);
+    size_t running = 0;
+
+    if (list != NULL)
+    {
+        while ((running < size) &&
+               (thrd_create(&list[running], work, &pool) == thrd_success))
+        {
+            running++;
+        }
+    }
+    /* The calling thread does the job when no thread can be created */
+    if (running == 0)
+    {
+        work(&pool);
+    }
+    for (size_t i = 0; i < running; i++)
+    {
+        thrd_join(list[i], NULL);
+    }
+    free(list);
+    mtx_destroy(&pool.mutex);
+    return 1;
+}
+
+static json_map *collect(batch_file *files, size_t count)
+{
+    json_map *map = json_map_create(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        json *node = files[i].node;
+
+        if (node == NULL)
+        {
+            continue;
+        }
+
+        json *item = map ? json_map_insert(map, files[i].path, node) : NULL;
+
+        /* Repeated paths, the trees left are released once the map fails */
+        if (item != node)
+        {
+            json_free(node);
+        }
+        if ((item == NULL) && (map != NULL))
+        {
+            json_map_destroy(map, json_free);
+            map = NULL;
+        }
+        files[i].node = NULL;
+    }
+    return map;
+}
+
+/*
+ * Parses a list of files, the trees are returned in a map keyed by path
+ * (release them with json_map_destroy(map, json_free)), the files that
+ * can not be read or parsed are not in the map, errors (optional) has an
+ * element per path, code is JSON_ERROR_READ when the file was not read
+ * and offset is the position of the error when it was not parsed
+ */
+json_map *json_parse_files(const char **paths, size_t count,
+    const json_ingest_options *options, json_error *errors)
+{
+    if ((paths == NULL) && (count > 0))
+    {
+        return NULL;
+    }
+
+    batch_file *files = calloc(count ? count : 1, sizeof *files);
+
+    if (files == NULL)
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        files[i].path = paths[i];
+    }
+#ifdef BATCH_URING
+    ring_load(files, count);
+#endif
+    if (!pool_load(files, count, options ? options->threads : 0))
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            json_free(files[i].node);
+        }
+        free(files);
+        return NULL;
+    }
+    if (errors != NULL)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            errors[i] = files[i].error;
+        }
+    }
+
+    json_map *map = collect(files, count);
+
+    free(files);
+    return map;
+}
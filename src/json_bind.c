@@ -0,0 +1,422 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "json_parser.h"
+#include "json_struct.h"
+
+/*
+ * Binding of a json text to a C struct, the events of the parser are
+ * stored straight into the members, no tree is built
+ */
+
+typedef struct
+{
+    /* Members of a struct or element of an array */
+    const json_field *fields;
+    char *base;
+    /* Arrays: number of elements bound and capacity */
+    size_t *count;
+    size_t room;
+} bind_level;
+
+typedef struct
+{
+    bind_level *levels;
+    size_t depth, size;
+    /* Depth inside a value not described by the fields */
+    size_t skip;
+    /* Reported when the binding stops */
+    enum json_error_code error;
+} bind_state;
+
+static int push_level(bind_state *state, const bind_level *level)
+{
+    if (state->depth == state->size)
+    {
+        size_t size = state->size ? state->size * 2 : 8;
+        bind_level *levels = realloc(state->levels, size * sizeof *levels);
+
+        if (levels == NULL)
+        {
+            return 0;
+        }
+        state->levels = levels;
+        state->size = size;
+    }
+    state->levels[state->depth++] = *level;
+    return 1;
+}
+
+static const json_field *find_field(const json_field *fields,
+    const char *name)
+{
+    for (; fields->name != NULL; fields++)
+    {
+        if (strcmp(fields->name, name) == 0)
+        {
+            return fields;
+        }
+    }
+    return NULL;
+}
+
+/* Member or element receiving a value, NULL when it is not described */
+static const json_field *target(bind_state *state, const json *node,
+    char **data)
+{
+    bind_level *level = &state->levels[state->depth - 1];
+
+    if (level->count != NULL)
+    {
+        if (*level->count == level->room)
+        {
+            state->error = JSON_ERROR_NODES;
+            return NULL;
+        }
+        *data = level->base + *level->count * level->fields->size;
+        (*level->count)++;
+        return level->fields;
+    }
+
+    const json_field *field = find_field(level->fields, node->name);
+
+    if (field != NULL)
+    {
+        *data = level->base + field->offset;
+    }
+    return field;
+}
+
+static int store_signed(char *data, size_t size, int64_t value)
+{
+    switch (size)
+    {
+        case sizeof(int8_t):
+            if ((value < INT8_MIN) || (value > INT8_MAX))
+            {
+                return 0;
+            }
+            *(int8_t *)(void *)data = (int8_t)value;
+            return 1;
+        case sizeof(int16_t):
+            if ((value < INT16_MIN) || (value > INT16_MAX))
+            {
+                return 0;
+            }
+            *(int16_t *)(void *)data = (int16_t)value;
+            return 1;
+        case sizeof(int32_t):
+            if ((value < INT32_MIN) || (value > INT32_MAX))
+            {
+                return 0;
+            }
+            *(int32_t *)(void *)data = (int32_t)value;
+            return 1;
+        case sizeof(int64_t):
+            *(int64_t *)(void *)data = value;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int store_unsigned(char *data, size_t size, uint64_t value)
+{
+    switch (size)
+    {
+        case sizeof(uint8_t):
+            if (value > UINT8_MAX)
+            {
+                return 0;
+            }
+            *(uint8_t *)(void *)data = (uint8_t)value;
+            return 1;
+        case sizeof(uint16_t):
+            if (value > UINT16_MAX)
+            {
+                return 0;
+            }
+            *(uint16_t *)(void *)data = (uint16_t)value;
+            return 1;
+        case sizeof(uint32_t):
+            if (value > UINT32_MAX)
+            {
+                return 0;
+            }
+            *(uint32_t *)(void *)data = (uint32_t)value;
+            return 1;
+        case sizeof(uint64_t):
+            *(uint64_t *)(void *)data = value;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int store_double(char *data, size_t size, double value)
+{
+    if (size == sizeof(float))
+    {
+        *(float *)(void *)data = (float)value;
+        return 1;
+    }
+    if (size == sizeof(double))
+    {
+        *(double *)(void *)data = value;
+        return 1;
+    }
+    return 0;
+}
+
+static int store_string(bind_state *state, const json_field *field,
+    char *data, const char *str)
+{
+    size_t length = strlen(str);
+
+    if (field->type == JSON_BIND_CHARS)
+    {
+        if (length >= field->size)
+        {
+            state->error = JSON_ERROR_STRING;
+            return 0;
+        }
+        memcpy(data, str, length + 1);
+        return 1;
+    }
+
+    char *copy = malloc(length + 1);
+
+    if (copy == NULL)
+    {
+        state->error = JSON_ERROR_NONE;
+        return 0;
+    }
+    memcpy(copy, str, length + 1);
+    free(*(char **)(void *)data);
+    *(char **)(void *)data = copy;
+    return 1;
+}
+
+/* Stores a scalar, returns 0 when the type doesn't match */
+static int store(bind_state *state, const json_field *field, char *data,
+    const json *node)
+{
+    switch (field->type)
+    {
+        case JSON_BIND_INTEGER:
+            return (node->type == JSON_INTEGER)
+                && !(node->flags & JSON_UNSIGNED)
+                && store_signed(data, field->size, node->value.integer);
+        case JSON_BIND_UNSIGNED:
+            return json_is_real(node)
+                && store_unsigned(data, field->size, node->value.real);
+        case JSON_BIND_DOUBLE:
+            return json_is_number(node)
+                && store_double(data, field->size, json_double(node));
+        case JSON_BIND_BOOLEAN:
+            return (node->type == JSON_BOOLEAN)
+                && store_unsigned(data, field->size, json_boolean(node) != 0);
+        case JSON_BIND_STRING:
+        case JSON_BIND_CHARS:
+            return (node->type == JSON_STRING)
+                && store_string(state, field, data, node->value.string);
+        default:
+            return 0;
+    }
+}
+
+/* Opens a struct or an array, returns 0 when the type doesn't match */
+static int open_group(bind_state *state, const json_field *field, char *data,
+    enum json_event event)
+{
+    bind_level level = {field->fields, data, NULL, 0};
+
+    if (field->type == JSON_BIND_OBJECT)
+    {
+        if (event != JSON_EVENT_START_OBJECT)
+        {
+            return 0;
+        }
+    }
+    else if (field->type == JSON_BIND_ARRAY)
+    {
+        /* Elements can not be arrays (the counter is a member) */
+        if ((event != JSON_EVENT_START_ARRAY) || (field->name == NULL))
+        {
+            return 0;
+        }
+        /* The counter is a member of the struct holding the array */
+        level.count = (size_t *)(void *)(data - field->offset + field->count);
+        level.room = field->size / field->fields->size;
+        *level.count = 0;
+    }
+    else
+    {
+        return 0;
+    }
+    if (!push_level(state, &level))
+    {
+        state->error = JSON_ERROR_NONE;
+        return -1;
+    }
+    return 1;
+}
+
+static int bind_event(enum json_event event, const json *node, void *data)
+{
+    bind_state *state = data;
+    int closing = (event == JSON_EVENT_END_OBJECT) ||
+                  (event == JSON_EVENT_END_ARRAY);
+    int opening = (event == JSON_EVENT_START_OBJECT) ||
+                  (event == JSON_EVENT_START_ARRAY);
+
+    if (event == JSON_EVENT_KEY)
+    {
+        return 1;
+    }
+    if (state->skip > 0)
+    {
+        state->skip += (size_t)opening;
+        state->skip -= (size_t)closing;
+        return 1;
+    }
+    if (closing)
+    {
+        state->depth--;
+        return 1;
+    }
+    /* The root is the struct itself */
+    if (node->parent == NULL)
+    {
+        if (event != JSON_EVENT_START_OBJECT)
+        {
+            return 0;
+        }
+        state->depth = 1;
+        return 1;
+    }
+
+    char *member = NULL;
+    const json_field *field = target(state, node, &member);
+
+    if (field == NULL)
+    {
+        if (state->error != JSON_ERROR_TYPE)
+        {
+            return 0;
+        }
+        /* Members not described are skipped */
+        state->skip = (size_t)opening;
+        return 1;
+    }
+    /* null leaves the member untouched */
+    if (event == JSON_EVENT_NULL)
+    {
+        return 1;
+    }
+    if (opening)
+    {
+        return open_group(state, field, member, event) > 0;
+    }
+    return store(state, field, member, node);
+}
+
+/* Releases a member and sets it to 0 */
+static void free_value(const json_field *field, char *data)
+{
+    if (field->type == JSON_BIND_STRING)
+    {
+        free(*(char **)(void *)data);
+    }
+    else if (field->type == JSON_BIND_OBJECT)
+    {
+        json_bind_free(field->fields, data);
+    }
+    else if ((field->type == JSON_BIND_ARRAY) && (field->name != NULL))
+    {
+        const json_field *element = field->fields;
+        size_t *count = (size_t *)(void *)(data - field->offset +
+            field->count
+        );
+
+        for (size_t i = 0; i < *count; i++)
+        {
+            free_value(element, data + i * element->size);
+        }
+        *count = 0;
+    }
+    memset(data, 0, field->size);
+}
+
+/* Releases the strings allocated by json_bind and zeroes the members */
+void json_bind_free(const json_field *fields, void *object)
+{
+    if ((fields == NULL) || (object == NULL))
+    {
+        return;
+    }
+    for (; fields->name != NULL; fields++)
+    {
+        free_value(fields, (char *)object + fields->offset);
+    }
+}
+
+/*
+ * Fills a struct described by fields from a json object, the struct must
+ * be zeroed or previously bound, members not found in the text are left
+ * to 0 and names not described are ignored, returns 1 on success, 0 on
+ * fail (error->code is JSON_ERROR_TYPE when a value doesn't match the
+ * type of its member)
+ */
+int json_bind(const char *str, const json_field *fields, void *object,
+    json_error *error)
+{
+    if ((str == NULL) || (fields == NULL) || (object == NULL))
+    {
+        if (error != NULL)
+        {
+            error->offset = error->line = error->column = 0;
+            error->code = JSON_ERROR_NONE;
+        }
+        return 0;
+    }
+
+    bind_level root = {fields, object, NULL, 0};
+    bind_state state = {NULL, 0, 0, 0, JSON_ERROR_TYPE};
+
+    if (!push_level(&state, &root))
+    {
+        return 0;
+    }
+    state.depth = 0;
+    json_bind_free(fields, object);
+
+    int result = parser_events(str, str + strlen(str), bind_event, &state,
+        error
+    );
+
+    free(state.levels);
+    if (result == 1)
+    {
+        return 1;
+    }
+    if (error != NULL)
+    {
+        if (result == 0)
+        {
+            error->code = state.error;
+        }
+        if (error->code == JSON_ERROR_NONE)
+        {
+            error->offset = error->line = error->column = 0;
+        }
+    }
+    json_bind_free(fields, object);
+    return 0;
+}
@@ -7,7 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
-#include "json_struct.h"
+#include "json_arena.h"
 #include "json_macros.h"
 
 static size_t string_size(const char *str)
@@ -146,14 +146,37 @@ json *json_new_string(const char *name, const char *value)
     return new_string(name, copy_string(value));
 }
 
+/* Integers greater than INT64_MAX are stored as unsigned */
+static json *set_real_value(json *node, uint64_t value)
+{
+    node->value.real = value;
+    if (value > INT64_MAX)
+    {
+        node->flags |= JSON_UNSIGNED;
+    }
+    return node;
+}
+
 json *json_new_integer(const char *name, long long value)
 {
-    return new_number(JSON_INTEGER, name, (double)value);
+    json *node = new_number(JSON_INTEGER, name, 0);
+
+    if (node != NULL)
+    {
+        node->value.integer = value;
+    }
+    return node;
 }
 
 json *json_new_real(const char *name, unsigned long long value)
 {
-    return new_number(JSON_INTEGER, name, (double)value);
+    json *node = new_number(JSON_INTEGER, name, 0);
+
+    if (node != NULL)
+    {
+        set_real_value(node, value);
+    }
+    return node;
 }
 
 json *json_new_double(const char *name, double value)
@@ -171,6 +194,34 @@ json *json_new_null(const char *name)
     return new_number(JSON_NULL, name, 0);
 }
 
+/* Heap memory attached to an arena tree must be walked by json_free */
+static void touch(const json *node)
+{
+    if (node->flags & (JSON_DOCUMENT | JSON_ARENA_NODE))
+    {
+        arena_touch(node);
+    }
+}
+
+static void free_name(json *node)
+{
+    if (!(node->flags & JSON_SHARED_NAME))
+    {
+        free(node->name);
+    }
+    node->flags &= ~(unsigned)(JSON_SHARED_NAME | JSON_INTERNED_NAME);
+}
+
+static void free_string(json *node)
+{
+    if (((node->type == JSON_STRING) || (node->flags & JSON_NUMBER_TEXT)) &&
+        !(node->flags & JSON_SHARED_STRING))
+    {
+        free(node->value.string);
+    }
+    node->flags &= ~(unsigned)(JSON_SHARED_STRING | JSON_NUMBER_TEXT);
+}
+
 json *json_set_name(json *node, const char *name)
 {
     if ((node == NULL) || ((node->parent != NULL) && (!node->name == !name)))
@@ -184,8 +235,9 @@ json *json_set_name(json *node, const char *name)
     {
         return NULL;
     }
-    free(node->name);
+    free_name(node);
     node->name = str;
+    touch(node);
     return node;
 }
 
@@ -197,21 +249,18 @@ static json *set_string(json *node, char *value)
     {
         return NULL;
     }
-    if (node->type == JSON_STRING)
-    {
-        free(node->value.string);
-    }
+    free_string(node);
+    node->flags &= ~(unsigned)JSON_UNSIGNED;
     node->type = JSON_STRING;
     node->value.string = value;
+    touch(node);
     return node;
 }
 
 static json *set_number(json *node, enum json_type type, double value)
 {
-    if (node->type == JSON_STRING)
-    {
-        free(node->value.string);
-    }
+    free_string(node);
+    node->flags &= ~(unsigned)JSON_UNSIGNED;
     node->type = type;
     node->value.number = value;
     return node;
@@ -249,7 +298,9 @@ json *json_set_integer(json *node, long long value)
     {
         return NULL;
     }
-    return set_number(node, JSON_INTEGER, (double)value);
+    set_number(node, JSON_INTEGER, 0);
+    node->value.integer = value;
+    return node;
 }
 
 json *json_set_real(json *node, unsigned long long value)
@@ -258,7 +309,8 @@ json *json_set_real(json *node, unsigned long long value)
     {
         return NULL;
     }
-    return set_number(node, JSON_INTEGER, (double)value);
+    set_number(node, JSON_INTEGER, 0);
+    return set_real_value(node, value);
 }
 
 json *json_set_double(json *node, double value)
@@ -301,6 +353,58 @@ static int not_pushable(const json *parent, const json *child)
     return ((parent->type == JSON_OBJECT) ^ (child->name != NULL));
 }
 
+/* Names of a subtree leaving its document are no longer interned */
+static void forget_names(json *node)
+{
+    json *root = node;
+
+    while (node != NULL)
+    {
+        node->flags &= ~(unsigned)JSON_INTERNED_NAME;
+        if (node->child != NULL)
+        {
+            node = node->child;
+            continue;
+        }
+        while ((node != root) && (node->next == NULL))
+        {
+            node = node->parent;
+        }
+        node = node != root ? node->next : NULL;
+    }
+}
+
+/* Only arena nodes can have interned names */
+static int interned(const json *node)
+{
+    return (node->flags & (JSON_DOCUMENT | JSON_ARENA_NODE))
+        && arena_interns(node);
+}
+
+/*
+ * A popped node loses its interned names, so the pushed node can only
+ * have them when it is the root of another document
+ */
+static void adopt(json *parent, json *child)
+{
+    if ((child->flags & JSON_DOCUMENT) && interned(child))
+    {
+        forget_names(child);
+    }
+    child->parent = parent;
+    touch(parent);
+}
+
+/* Interned names are searched in the document of the parent */
+static void orphan(json *parent, json *child)
+{
+    if (interned(parent))
+    {
+        forget_names(child);
+    }
+    child->parent = NULL;
+}
+
 json *json_push_fast(json *parent, json *where, json *child)
 {
     if (where == NULL)
@@ -324,7 +428,7 @@ json *json_push_front(json *parent, json *child)
         child->next = parent->child;
         parent->child->prev = child;
     }
-    child->parent = parent;
+    adopt(parent, child);
     parent->child = child;
     return child;
 }
@@ -350,7 +454,7 @@ json *json_push_back(json *parent, json *child)
         node->next = child;
         child->prev = node;
     }
-    child->parent = parent;
+    adopt(parent, child);
     return child;
 }
 
@@ -371,7 +475,7 @@ json *json_push_before(json *where, json *child)
         child->prev = where->prev;
         where->prev->next = child;
     }
-    child->parent = parent;
+    adopt(parent, child);
     child->next = where;
     where->prev = child;
     return child;
@@ -390,7 +494,7 @@ json *json_push_after(json *where, json *child)
         child->next = where->next;
         where->next->prev = child;
     }
-    child->parent = parent;
+    adopt(parent, child);
     child->prev = where;
     where->next = child;
     return child;
@@ -427,7 +531,7 @@ json *json_push_at(json *parent, json *child, size_t item)
         child->next = node;
         node->prev = child;
     }
-    child->parent = parent;
+    adopt(parent, child);
     return child;
 }
 
@@ -451,7 +555,7 @@ json *json_pop(json *child)
     {
         child->next->prev = child->prev;
     }
-    child->parent = NULL;
+    orphan(parent, child);
     child->prev = NULL;
     child->next = NULL; 
     return child;
@@ -472,7 +576,7 @@ json *json_pop_front(json *parent)
         child->next->prev = NULL;
         child->next = NULL;
     }
-    child->parent = NULL;
+    orphan(parent, child);
     return child;
 }
 
@@ -497,7 +601,7 @@ json *json_pop_back(json *parent)
     {
         parent->child = NULL;
     }
-    child->parent = NULL;
+    orphan(parent, child);
     return child;
 }
 
@@ -530,7 +634,7 @@ json *json_pop_at(json *parent, size_t item)
     {
         child->next->prev = child->prev;
     }
-    child->parent = NULL;
+    orphan(parent, child);
     child->prev = NULL;
     child->next = NULL;
     return child;
@@ -564,6 +668,13 @@ json *json_delete(json *node)
     return next;
 }
 
+/* json_free helper - an arena without heap memory is released at once */
+static int owns_tree(const json *node)
+{
+    return (node->flags & JSON_DOCUMENT)
+        && !((const json_arena *)(const void *)node)->dirty;
+}
+
 void json_free(json *node)
 {
     json *parent = node ? node->parent : NULL;
@@ -571,7 +682,7 @@ void json_free(json *node)
 
     while (node != parent)
     {
-        next = node->child;
+        next = owns_tree(node) ? NULL : node->child;
         node->child = NULL;
         if (next == NULL)
         {
@@ -583,12 +694,16 @@ void json_free(json *node)
             {
                 next = node->parent;
             }
-            free(node->name);
-            if (node->type == JSON_STRING)
+            free_name(node);
+            free_string(node);
+            if (node->flags & JSON_DOCUMENT)
+            {
+                arena_destroy((json_arena *)(void *)node);
+            }
+            else if (!(node->flags & JSON_ARENA_NODE))
             {
-                free(node->value.string);
+                free(node);
             }
-            free(node);
         }
         node = next;
     }
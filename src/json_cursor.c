@@ -0,0 +1,750 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "json_number.h"
+#include "json_parser.h"
+#include "json_simd.h"
+
+/*
+ * A cursor points to the first character of a value (and to the opening
+ * quote of its name inside an object), values not visited are skipped
+ * by bracket matching, they are validated only when materialized
+ */
+
+static int is_space(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static int is_delimiter(char c)
+{
+    return is_space(c) || (c == ',') || (c == ']') || (c == '}')
+        || (c == ':') || (c == '\0');
+}
+
+static const char *skip_spaces(const char *str, const char *end)
+{
+    while ((str < end) && is_space(*str))
+    {
+        str++;
+    }
+    return str;
+}
+
+/* Returns a pointer past the closing quote or NULL */
+static const char *skip_string(const char *str, const char *end)
+{
+    while ((str = simd_find_special(str, end)) < end)
+    {
+        switch (*str)
+        {
+            case '"':
+                return str + 1;
+            case '\\':
+                if (end - str < 2)
+                {
+                    return NULL;
+                }
+                str += 2;
+                break;
+            default:
+                /* Control character */
+                return NULL;
+        }
+    }
+    return NULL;
+}
+
+static const char *skip_scalar(const char *str, const char *end)
+{
+    while ((str < end) && !is_delimiter(*str))
+    {
+        str++;
+    }
+    return str;
+}
+
+/* Skips an object or an array by bracket matching */
+static const char *skip_group(const char *str, const char *end)
+{
+    size_t depth = 1;
+
+    str++;
+    while ((str = simd_find_group(str, end)) < end)
+    {
+        switch (*str)
+        {
+            case '"':
+                str = skip_string(str + 1, end);
+                if (str == NULL)
+                {
+                    return NULL;
+                }
+                continue;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            default:
+                if (--depth == 0)
+                {
+                    return str + 1;
+                }
+                break;
+        }
+        str++;
+    }
+    return NULL;
+}
+
+/* Returns a pointer past the value or NULL */
+static const char *skip_value(const char *str, const char *end)
+{
+    switch (*str)
+    {
+        case '{':
+        case '[':
+            return skip_group(str, end);
+        case '"':
+            return skip_string(str + 1, end);
+        default:
+            return skip_scalar(str, end);
+    }
+}
+
+/* Reads the name of a member and moves to its value */
+static int set_member(json_cursor *cursor, const char *str)
+{
+    const char *end = cursor->end;
+
+    if ((str == end) || (*str != '"'))
+    {
+        return 0;
+    }
+    cursor->name = str;
+    str = skip_string(str + 1, end);
+    if (str == NULL)
+    {
+        return 0;
+    }
+    str = skip_spaces(str, end);
+    if ((str == end) || (*str != ':'))
+    {
+        return 0;
+    }
+    str = skip_spaces(str + 1, end);
+    if (str == end)
+    {
+        return 0;
+    }
+    cursor->text = str;
+    return 1;
+}
+
+static int is_cursor(const json_cursor *cursor)
+{
+    return (cursor != NULL) && (cursor->text < cursor->end);
+}
+
+int json_cursor_init(json_cursor *cursor, const char *str, size_t length)
+{
+    if ((cursor == NULL) || (str == NULL))
+    {
+        return 0;
+    }
+    cursor->end = str + length;
+    cursor->text = skip_spaces(str, cursor->end);
+    cursor->name = NULL;
+    return cursor->text < cursor->end;
+}
+
+/* Loads a scalar into a node (strings without value), returns 0 on fail */
+static int load(const json_cursor *cursor, json *node)
+{
+    memset(node, 0, sizeof *node);
+    if (!is_cursor(cursor))
+    {
+        return 0;
+    }
+
+    const char *str = cursor->text;
+    const char *end = skip_scalar(str, cursor->end);
+    size_t length = (size_t)(end - str);
+
+    switch (*str)
+    {
+        case '{':
+            node->type = JSON_OBJECT;
+            return 1;
+        case '[':
+            node->type = JSON_ARRAY;
+            return 1;
+        case '"':
+            node->type = JSON_STRING;
+            return 1;
+        case 't':
+            node->type = JSON_BOOLEAN;
+            node->value.number = 1;
+            return (length == 4) && !memcmp(str, "true", 4);
+        case 'f':
+            node->type = JSON_BOOLEAN;
+            return (length == 5) && !memcmp(str, "false", 5);
+        case 'n':
+            node->type = JSON_NULL;
+            return (length == 4) && !memcmp(str, "null", 4);
+        default:
+            return number_parse(node, str, end);
+    }
+}
+
+enum json_type json_cursor_type(const json_cursor *cursor)
+{
+    json node;
+
+    return load(cursor, &node) ? node.type : JSON_UNDEFINED;
+}
+
+/* Moves to the first element of an object or an array */
+int json_cursor_child(const json_cursor *parent, json_cursor *child)
+{
+    if (!is_cursor(parent) || (child == NULL))
+    {
+        return 0;
+    }
+
+    const char *str = parent->text;
+    const char *end = parent->end;
+
+    if ((*str != '{') && (*str != '['))
+    {
+        return 0;
+    }
+
+    int object = *str == '{';
+
+    str = skip_spaces(str + 1, end);
+    if ((str == end) || (*str == (object ? '}' : ']')))
+    {
+        return 0;
+    }
+    child->end = end;
+    child->name = NULL;
+    if (object)
+    {
+        return set_member(child, str);
+    }
+    child->text = str;
+    return 1;
+}
+
+/* Moves to the next element of the same group */
+int json_cursor_next(json_cursor *cursor)
+{
+    if (!is_cursor(cursor))
+    {
+        return 0;
+    }
+
+    const char *end = cursor->end;
+    const char *str = skip_value(cursor->text, end);
+
+    if (str == NULL)
+    {
+        return 0;
+    }
+    str = skip_spaces(str, end);
+    if ((str == end) || (*str != ','))
+    {
+        return 0;
+    }
+    str = skip_spaces(str + 1, end);
+    if (str == end)
+    {
+        return 0;
+    }
+    if (cursor->name != NULL)
+    {
+        return set_member(cursor, str);
+    }
+    cursor->text = str;
+    return 1;
+}
+
+/* Returns the name of a member unescaped (allocated) or NULL */
+static char *cursor_name(const json_cursor *cursor)
+{
+    const char *str = cursor->name + 1;
+    const char *end = skip_string(str, cursor->end) - 1;
+    size_t length = (size_t)(end - str);
+
+    if (memchr(str, '\\', length) == NULL)
+    {
+        char *name = malloc(length + 1);
+
+        if (name != NULL)
+        {
+            memcpy(name, str, length);
+            name[length] = '\0';
+        }
+        return name;
+    }
+
+    /* Escaped names are rare, let the parser unescape them */
+    json *node = parser_parse(str - 1, end + 1, NULL, NULL);
+
+    if (node == NULL)
+    {
+        return NULL;
+    }
+
+    char *name = node->value.string;
+
+    node->value.string = NULL;
+    json_free(node);
+    return name;
+}
+
+static int equal_name(const json_cursor *cursor, const char *name,
+    size_t length)
+{
+    const char *str = cursor->name + 1;
+    const char *end = simd_find_special(str, cursor->text);
+
+    /* Names without escape sequences are compared in place */
+    if (*end == '"')
+    {
+        return ((size_t)(end - str) == length) && !memcmp(str, name, length);
+    }
+
+    char *temp = cursor_name(cursor);
+    int equal = (temp != NULL) && (strcmp(temp, name) == 0);
+
+    free(temp);
+    return equal;
+}
+
+int json_cursor_find(const json_cursor *object, const char *name,
+    json_cursor *value)
+{
+    if (!is_cursor(object) || (*object->text != '{') || (name == NULL))
+    {
+        return 0;
+    }
+
+    json_cursor cursor;
+    size_t length = strlen(name);
+
+    if (!json_cursor_child(object, &cursor))
+    {
+        return 0;
+    }
+    do
+    {
+        if (equal_name(&cursor, name, length))
+        {
+            if (value != NULL)
+            {
+                *value = cursor;
+            }
+            return 1;
+        }
+    } while (json_cursor_next(&cursor));
+    return 0;
+}
+
+int json_cursor_at(const json_cursor *array, size_t index, json_cursor *value)
+{
+    if (!is_cursor(array) || (*array->text != '['))
+    {
+        return 0;
+    }
+
+    json_cursor cursor;
+
+    if (!json_cursor_child(array, &cursor))
+    {
+        return 0;
+    }
+    while (index-- > 0)
+    {
+        if (!json_cursor_next(&cursor))
+        {
+            return 0;
+        }
+    }
+    if (value != NULL)
+    {
+        *value = cursor;
+    }
+    return 1;
+}
+
+long long json_cursor_integer(const json_cursor *cursor)
+{
+    json node;
+
+    return load(cursor, &node) ? json_integer(&node) : 0;
+}
+
+double json_cursor_double(const json_cursor *cursor)
+{
+    json node;
+
+    return load(cursor, &node) ? json_double(&node) : 0.0;
+}
+
+double json_cursor_number(const json_cursor *cursor)
+{
+    json node;
+
+    return load(cursor, &node) ? json_number(&node) : 0.0;
+}
+
+int json_cursor_boolean(const json_cursor *cursor)
+{
+    json node;
+
+    return load(cursor, &node) ? json_boolean(&node) : 0;
+}
+
+/* Builds (and validates) a tree with the value, the caller owns it */
+json *json_cursor_value(const json_cursor *cursor)
+{
+    if (!is_cursor(cursor))
+    {
+        return NULL;
+    }
+
+    const char *end = skip_value(cursor->text, cursor->end);
+
+    if (end == NULL)
+    {
+        return NULL;
+    }
+
+    json *node = parser_parse(cursor->text, end, NULL, NULL);
+
+    if ((node != NULL) && (cursor->name != NULL))
+    {
+        node->name = cursor_name(cursor);
+        if (node->name == NULL)
+        {
+            json_free(node);
+            return NULL;
+        }
+    }
+    return node;
+}
+
+/*
+ * Projection: only the values on a set of pointers are built, the rest
+ * of the text is validated without allocating (json_valid) and skipped
+ * by bracket matching, a segment "*" matches any member or element
+ */
+
+/* Pointers of a projection (one bit per pointer in the masks) */
+#define PROJECTION_POINTERS 64
+
+typedef struct
+{
+    /* Segments of each pointer, decoded and NUL terminated */
+    const char *segments[PROJECTION_POINTERS];
+    size_t depths[PROJECTION_POINTERS];
+    size_t count;
+    char *text;
+} json_projection;
+
+/* Decodes a pointer ("~0" to '~' and "~1" to '/'), returns the end */
+static char *decode(const char *path, char *buf, size_t *depth)
+{
+    *depth = 0;
+    if (*path == '/')
+    {
+        path++;
+    }
+    while (*path != '\0')
+    {
+        for (; (*path != '\0') && (*path != '/'); path++)
+        {
+            if ((path[0] == '~') && ((path[1] == '0') || (path[1] == '1')))
+            {
+                *buf++ = path[1] == '0' ? '~' : '/';
+                path++;
+            }
+            else
+            {
+                *buf++ = *path;
+            }
+        }
+        *buf++ = '\0';
+        (*depth)++;
+        if (*path == '/')
+        {
+            path++;
+        }
+    }
+    return buf;
+}
+
+static int projection_init(json_projection *projection,
+    const char **pointers, size_t count)
+{
+    size_t size = 0;
+
+    if ((pointers == NULL) || (count > PROJECTION_POINTERS))
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (pointers[i] == NULL)
+        {
+            return 0;
+        }
+        size += strlen(pointers[i]) + 1;
+    }
+    projection->text = malloc(size + 1);
+    if (projection->text == NULL)
+    {
+        return 0;
+    }
+
+    char *buf = projection->text;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        projection->segments[i] = buf;
+        buf = decode(pointers[i], buf, &projection->depths[i]);
+    }
+    projection->count = count;
+    return 1;
+}
+
+/* Segment of a pointer at a given depth */
+static const char *segment(const json_projection *projection, size_t index,
+    size_t depth)
+{
+    const char *str = projection->segments[index];
+
+    while (depth-- > 0)
+    {
+        str += strlen(str) + 1;
+    }
+    return str;
+}
+
+static int is_index(const char *str, size_t index)
+{
+    if ((*str == '\0') || (str[strspn(str, "0123456789")] != '\0'))
+    {
+        return 0;
+    }
+    return strtoul(str, NULL, 10) == index;
+}
+
+/* Whether a segment names a member or an element (index) of a group */
+static int matches(const json_cursor *element, const char *name,
+    size_t index)
+{
+    if (strcmp(name, "*") == 0)
+    {
+        return 1;
+    }
+    return element->name != NULL
+        ? equal_name(element, name, strlen(name))
+        : is_index(name, index);
+}
+
+/* Pointers of mask going on through the element of a group at depth */
+static uint64_t descend(const json_projection *projection, uint64_t mask,
+    size_t depth, const json_cursor *element, size_t index)
+{
+    uint64_t next = 0;
+
+    for (size_t i = 0; i < projection->count; i++)
+    {
+        uint64_t bit = (uint64_t)1 << i;
+
+        if ((mask & bit) && matches(element, segment(projection, i, depth),
+            index))
+        {
+            next |= bit;
+        }
+    }
+    return next;
+}
+
+/* Whether a pointer of mask ends at depth (the value is taken whole) */
+static int ends(const json_projection *projection, uint64_t mask,
+    size_t depth)
+{
+    for (size_t i = 0; i < projection->count; i++)
+    {
+        if ((mask & ((uint64_t)1 << i)) && (projection->depths[i] == depth))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int project(const json_projection *, const json_cursor *, uint64_t,
+    size_t, json *, json **);
+
+/* Keeps the index of an element, the ones skipped before it are null */
+static int hold_index(json *last, size_t skipped)
+{
+    while (skipped-- > 0)
+    {
+        json *null = json_new_null(NULL);
+
+        if (null == NULL)
+        {
+            return 0;
+        }
+        json_push_before(last, null);
+    }
+    return 1;
+}
+
+/* Adds to group the members or elements on the pointers of mask */
+static int project_group(const json_projection *projection,
+    const json_cursor *cursor, uint64_t mask, size_t depth, json *group)
+{
+    json_cursor element;
+    json *last = NULL;
+    size_t index = 0, count = 0;
+
+    if (!json_cursor_child(cursor, &element))
+    {
+        return 1;
+    }
+    do
+    {
+        uint64_t next = descend(projection, mask, depth, &element, index);
+        json *prev = last;
+
+        if ((next != 0) &&
+            !project(projection, &element, next, depth + 1, group, &last))
+        {
+            return 0;
+        }
+        if ((last != prev) && (element.name == NULL))
+        {
+            if (!hold_index(last, index - count))
+            {
+                return 0;
+            }
+            count = index + 1;
+        }
+        index++;
+    } while (json_cursor_next(&element));
+    return 1;
+}
+
+/*
+ * Appends to parent (after last) the part of a value on the pointers of
+ * mask, groups without members or elements on them are left out,
+ * returns 0 on fail
+ */
+static int project(const json_projection *projection,
+    const json_cursor *cursor, uint64_t mask, size_t depth, json *parent,
+    json **last)
+{
+    json *node = NULL;
+
+    if (ends(projection, mask, depth))
+    {
+        node = json_cursor_value(cursor);
+    }
+    else if ((*cursor->text == '{') || (*cursor->text == '['))
+    {
+        node = *cursor->text == '{'
+            ? json_new_object(NULL)
+            : json_new_array(NULL);
+        if ((node != NULL) &&
+            !project_group(projection, cursor, mask, depth, node))
+        {
+            json_free(node);
+            return 0;
+        }
+        if ((node != NULL) && (node->child == NULL))
+        {
+            json_free(node);
+            return 1;
+        }
+        if ((node != NULL) && (cursor->name != NULL) &&
+            ((node->name = cursor_name(cursor)) == NULL))
+        {
+            json_free(node);
+            return 0;
+        }
+    }
+    else
+    {
+        /* A scalar has nothing to go on */
+        return 1;
+    }
+    if (node == NULL)
+    {
+        return 0;
+    }
+    *last = json_push_fast(parent, *last, node);
+    return 1;
+}
+
+/*
+ * Parses only the values on a set of pointers (up to 64), the tree keeps
+ * the groups leading to them, so the same pointers can be used on it
+ * (the elements of an array skipped before a kept one are null),
+ * returns NULL on a malformed text (error->code > 0) or on fail
+ */
+json *json_parse_projection(const char *str, size_t length,
+    const char **pointers, size_t count, json_error *error)
+{
+    if (!json_valid(str, length, error))
+    {
+        return NULL;
+    }
+
+    json_projection projection;
+    json_cursor root;
+    json *node = NULL;
+
+    if (!projection_init(&projection, pointers, count))
+    {
+        return NULL;
+    }
+    json_cursor_init(&root, str, length);
+
+    uint64_t mask = count < PROJECTION_POINTERS
+        ? ((uint64_t)1 << count) - 1
+        : ~(uint64_t)0;
+
+    /* A scalar document is returned as is */
+    if (ends(&projection, mask, 0) ||
+        ((*root.text != '{') && (*root.text != '[')))
+    {
+        node = json_cursor_value(&root);
+    }
+    else
+    {
+        node = *root.text == '{'
+            ? json_new_object(NULL)
+            : json_new_array(NULL);
+        if ((node != NULL) &&
+            !project_group(&projection, &root, mask, 0, node))
+        {
+            json_free(node);
+            node = NULL;
+        }
+    }
+    free(projection.text);
+    return node;
+}
@@ -0,0 +1,137 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#define FILE_MMAP
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "json_file.h"
+
+#ifdef FILE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define FILE_BUFFER_SIZE 65536
+
+/* Reads a stream of unknown size (pipes, devices, non POSIX systems) */
+static int file_read(json_file *view, FILE *file)
+{
+    char *text = NULL;
+    size_t length = 0, size = 0;
+
+    do
+    {
+        if (length == size)
+        {
+            size = size ? size * 2 : FILE_BUFFER_SIZE;
+
+            char *temp = realloc(text, size);
+
+            if (temp == NULL)
+            {
+                free(text);
+                return 0;
+            }
+            text = temp;
+        }
+        length += fread(text + length, 1, size - length, file);
+    } while (length == size);
+    if (ferror(file))
+    {
+        free(text);
+        return 0;
+    }
+    view->text = text;
+    view->size = length;
+    view->mapped = 0;
+    return 1;
+}
+
+#ifdef FILE_MMAP
+/* Maps a regular file (mapping an empty file fails), returns 0 on fail */
+static int file_map(json_file *view, int fd)
+{
+    struct stat info;
+
+    if ((fstat(fd, &info) == -1) || !S_ISREG(info.st_mode) ||
+        (info.st_size <= 0) || ((uintmax_t)info.st_size > SIZE_MAX))
+    {
+        return 0;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (addr == MAP_FAILED)
+    {
+        return 0;
+    }
+    /* The parser reads the text once from start to end */
+    posix_madvise(addr, size, POSIX_MADV_SEQUENTIAL);
+    view->text = addr;
+    view->size = size;
+    view->mapped = 1;
+    return 1;
+}
+#endif
+
+int file_load(json_file *view, const char *path)
+{
+#ifdef FILE_MMAP
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1)
+    {
+        return 0;
+    }
+    if (file_map(view, fd))
+    {
+        close(fd);
+        return 1;
+    }
+
+    FILE *file = fdopen(fd, "rb");
+
+    if (file == NULL)
+    {
+        close(fd);
+        return 0;
+    }
+#else
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL)
+    {
+        return 0;
+    }
+#endif
+
+    int rc = file_read(view, file);
+
+    fclose(file);
+    return rc;
+}
+
+void file_release(json_file *view)
+{
+    void *text = (void *)(uintptr_t)view->text;
+
+#ifdef FILE_MMAP
+    if (view->mapped)
+    {
+        munmap(text, view->size);
+        return;
+    }
+#endif
+    free(text);
+}
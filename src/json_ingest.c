@@ -0,0 +1,428 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include "json_parser.h"
+#include "json_file.h"
+
+/* Size of the chunks, they are cut at the next line break */
+#define INGEST_CHUNK_SIZE (1024 * 1024)
+/* Chunks parsed ahead of the first one not delivered (per thread) */
+#define INGEST_WINDOW 4
+
+typedef struct
+{
+    json *node;
+    /* Line of the record (relative to the chunk), column and offset */
+    json_error error;
+} ingest_record;
+
+typedef struct
+{
+    const char *str, *end;
+    /* Bytes of the text before the chunk */
+    size_t offset;
+    ingest_record *records;
+    size_t count, size;
+    /* Line breaks of the chunk and line number of its first line */
+    size_t breaks, line;
+    int counted, parsed, delivered, failed;
+} ingest_chunk;
+
+typedef struct
+{
+    ingest_chunk *chunks;
+    size_t count;
+    /* Next chunk to parse and first chunk not delivered */
+    size_t next, first;
+    /* Chunks whose first line is known */
+    size_t lined;
+    size_t window;
+    int stop;
+    mtx_t mutex;
+    cnd_t changed;
+} ingest_pool;
+
+/* Splits the text in chunks of whole lines */
+static ingest_chunk *split(const char *str, const char *end, size_t *count)
+{
+    size_t size = (size_t)(end - str) / INGEST_CHUNK_SIZE + 1;
+    ingest_chunk *chunks = calloc(size, sizeof *chunks);
+
+    if (chunks == NULL)
+    {
+        return NULL;
+    }
+
+    const char *text = str;
+    size_t n = 0;
+
+    while (str < end)
+    {
+        const char *cut = end;
+
+        if ((size_t)(end - str) > INGEST_CHUNK_SIZE)
+        {
+            cut = memchr(str + INGEST_CHUNK_SIZE, '\n',
+                (size_t)(end - str) - INGEST_CHUNK_SIZE
+            );
+            cut = cut ? cut + 1 : end;
+        }
+        chunks[n].str = str;
+        chunks[n].end = cut;
+        chunks[n].offset = (size_t)(str - text);
+        str = cut;
+        n++;
+    }
+    *count = n;
+    return chunks;
+}
+
+static size_t count_breaks(const char *str, const char *end)
+{
+    size_t count = 0;
+
+    while ((str = memchr(str, '\n', (size_t)(end - str))) != NULL)
+    {
+        count++;
+        str++;
+    }
+    return count;
+}
+
+static int add_record(ingest_chunk *chunk, json *node,
+    const json_error *error)
+{
+    if (chunk->count == chunk->size)
+    {
+        size_t size = chunk->size ? chunk->size * 2 : 256;
+        ingest_record *records = realloc(chunk->records,
+            size * sizeof *records
+        );
+
+        if (records == NULL)
+        {
+            return 0;
+        }
+        chunk->records = records;
+        chunk->size = size;
+    }
+    chunk->records[chunk->count].node = node;
+    chunk->records[chunk->count].error = *error;
+    chunk->count++;
+    return 1;
+}
+
+/* Parses the records of a chunk, returns 0 on fail */
+static int parse_chunk(ingest_chunk *chunk)
+{
+    json_options options = {.flags = JSON_PARSE_ARENA};
+    const char *str = chunk->str;
+    size_t line = 0;
+
+    while (str < chunk->end)
+    {
+        const char *end = memchr(str, '\n', (size_t)(chunk->end - str));
+
+        end = end ? end : chunk->end;
+        line++;
+        if (!parser_is_blank(str, end))
+        {
+            json_error error;
+            json *node = parser_parse(str, end, &options, &error);
+
+            if ((node == NULL) && (error.code == JSON_ERROR_NONE))
+            {
+                return 0;
+            }
+            if (node == NULL)
+            {
+                json_error_locate(&error, str);
+                error.offset += chunk->offset + (size_t)(str - chunk->str);
+            }
+            error.line = line;
+            if (!add_record(chunk, node, &error))
+            {
+                json_free(node);
+                return 0;
+            }
+        }
+        str = end + 1;
+    }
+    return 1;
+}
+
+/* Computes the first line of the chunks whose previous ones are counted */
+static void set_lines(ingest_pool *pool)
+{
+    while (pool->lined < pool->count)
+    {
+        ingest_chunk *chunk = &pool->chunks[pool->lined];
+
+        if (pool->lined == 0)
+        {
+            chunk->line = 0;
+        }
+        else
+        {
+            ingest_chunk *prev = chunk - 1;
+
+            if (!prev->counted)
+            {
+                return;
+            }
+            chunk->line = prev->line + prev->breaks;
+        }
+        pool->lined++;
+    }
+}
+
+static int work(void *data)
+{
+    ingest_pool *pool = data;
+
+    while (1)
+    {
+        mtx_lock(&pool->mutex);
+        while (!pool->stop && (pool->next < pool->count) &&
+               (pool->next >= pool->first + pool->window))
+        {
+            cnd_wait(&pool->changed, &pool->mutex);
+        }
+        if (pool->stop || (pool->next == pool->count))
+        {
+            mtx_unlock(&pool->mutex);
+            return 0;
+        }
+
+        ingest_chunk *chunk = &pool->chunks[pool->next++];
+
+        mtx_unlock(&pool->mutex);
+
+        /* Line numbers are published before parsing (unordered delivery) */
+        size_t breaks = count_breaks(chunk->str, chunk->end);
+
+        mtx_lock(&pool->mutex);
+        chunk->breaks = breaks;
+        chunk->counted = 1;
+        set_lines(pool);
+        cnd_broadcast(&pool->changed);
+        mtx_unlock(&pool->mutex);
+
+        int failed = !parse_chunk(chunk);
+
+        mtx_lock(&pool->mutex);
+        chunk->parsed = 1;
+        chunk->failed = failed;
+        cnd_broadcast(&pool->changed);
+        mtx_unlock(&pool->mutex);
+    }
+}
+
+/* Returns a chunk ready to be delivered or NULL */
+static ingest_chunk *ready(const ingest_pool *pool, int ordered)
+{
+    size_t last = ordered ? pool->first + 1 : pool->next;
+
+    for (size_t i = pool->first; (i < last) && (i < pool->lined); i++)
+    {
+        ingest_chunk *chunk = &pool->chunks[i];
+
+        if (chunk->parsed && !chunk->delivered)
+        {
+            return chunk;
+        }
+    }
+    return NULL;
+}
+
+static void free_records(ingest_chunk *chunk)
+{
+    for (size_t i = 0; i < chunk->count; i++)
+    {
+        json_free(chunk->records[i].node);
+    }
+    free(chunk->records);
+    chunk->records = NULL;
+    chunk->count = 0;
+}
+
+/* Calls back with the records of a chunk, returns 0 to stop */
+static int deliver(ingest_chunk *chunk, json_ingest_callback callback,
+    void *data)
+{
+    int result = 1;
+
+    for (size_t i = 0; (i < chunk->count) && result; i++)
+    {
+        ingest_record *record = &chunk->records[i];
+
+        record->error.line += chunk->line;
+        result = callback(record->node, &record->error, data) > 0;
+    }
+    free_records(chunk);
+    return result;
+}
+
+/* Runs on the calling thread, delivers the chunks as they are parsed */
+static int drain(ingest_pool *pool, int ordered, json_ingest_callback callback,
+    void *data)
+{
+    int result = 1;
+
+    mtx_lock(&pool->mutex);
+    while (pool->first < pool->count)
+    {
+        ingest_chunk *chunk = ready(pool, ordered);
+
+        if (chunk == NULL)
+        {
+            cnd_wait(&pool->changed, &pool->mutex);
+            continue;
+        }
+        if (chunk->failed)
+        {
+            result = -1;
+            break;
+        }
+        mtx_unlock(&pool->mutex);
+
+        int more = deliver(chunk, callback, data);
+
+        mtx_lock(&pool->mutex);
+        chunk->delivered = 1;
+        while ((pool->first < pool->count) &&
+               pool->chunks[pool->first].delivered)
+        {
+            pool->first++;
+        }
+        cnd_broadcast(&pool->changed);
+        if (!more)
+        {
+            result = 0;
+            break;
+        }
+    }
+    pool->stop = 1;
+    cnd_broadcast(&pool->changed);
+    mtx_unlock(&pool->mutex);
+    return result;
+}
+
+static int run(ingest_pool *pool, const json_ingest_options *options,
+    json_ingest_callback callback, void *data)
+{
+    size_t count = options && options->threads ? options->threads : 1;
+    int ordered = options && (options->flags & JSON_INGEST_ORDERED);
+
+    count = count < pool->count ? count : pool->count;
+
+    thrd_t *threads = malloc(count * sizeof *threads);
+    size_t running = 0;
+
+    if (threads == NULL)
+    {
+        return -1;
+    }
+    pool->window = count * INGEST_WINDOW;
+    while ((running < count) &&
+           (thrd_create(&threads[running], work, pool) == thrd_success))
+    {
+        running++;
+    }
+
+    int result = -1;
+
+    if (running > 0)
+    {
+        result = drain(pool, ordered, callback, data);
+    }
+    else
+    {
+        pool->stop = 1;
+    }
+    for (size_t i = 0; i < running; i++)
+    {
+        thrd_join(threads[i], NULL);
+    }
+    free(threads);
+    return result;
+}
+
+/*
+ * Parses the lines of a text (NDJSON / JSON Lines) on a pool of threads,
+ * returns 1 when all the records were delivered, 0 if the callback
+ * stopped the process, -1 on fail
+ */
+int json_ingest(const char *str, size_t length,
+    const json_ingest_options *options, json_ingest_callback callback,
+    void *data)
+{
+    if ((str == NULL) || (callback == NULL))
+    {
+        return -1;
+    }
+
+    ingest_pool pool = {0};
+
+    pool.chunks = split(str, str + length, &pool.count);
+    if (pool.chunks == NULL)
+    {
+        return -1;
+    }
+    if (pool.count == 0)
+    {
+        free(pool.chunks);
+        return 1;
+    }
+    if (mtx_init(&pool.mutex, mtx_plain) != thrd_success)
+    {
+        free(pool.chunks);
+        return -1;
+    }
+    if (cnd_init(&pool.changed) != thrd_success)
+    {
+        mtx_destroy(&pool.mutex);
+        free(pool.chunks);
+        return -1;
+    }
+
+    int result = run(&pool, options, callback, data);
+
+    /* Chunks not delivered when stopped */
+    for (size_t i = 0; i < pool.count; i++)
+    {
+        free_records(&pool.chunks[i]);
+    }
+    cnd_destroy(&pool.changed);
+    mtx_destroy(&pool.mutex);
+    free(pool.chunks);
+    return result;
+}
+
+/* The file is mapped in memory when possible */
+int json_ingest_file(const char *path, const json_ingest_options *options,
+    json_ingest_callback callback, void *data)
+{
+    if ((path == NULL) || (callback == NULL))
+    {
+        return -1;
+    }
+
+    json_file file;
+
+    if (!file_load(&file, path))
+    {
+        return -1;
+    }
+
+    int result = json_ingest(file.text, file.size, options, callback, data);
+
+    file_release(&file);
+    return result;
+}
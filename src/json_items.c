@@ -0,0 +1,397 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#define ITEMS_FD
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "json_parser.h"
+#include "json_simd.h"
+
+#ifdef ITEMS_FD
+#include <unistd.h>
+#endif
+
+/*
+ * Reader of the elements of a top-level array, the text is read in
+ * windows and only the element being parsed is kept in memory
+ */
+
+enum items_state
+{
+    ITEMS_OPEN,     // Before '['
+    ITEMS_FIRST,    // After '['
+    ITEMS_VALUE,    // After ','
+    ITEMS_COMMA,    // After an element
+    ITEMS_TAIL,     // After ']'
+    ITEMS_DONE,
+};
+
+struct json_items
+{
+    FILE *file;
+    int fd;
+    /* Document recycled from one element to the next */
+    json_arena *arena;
+    /* Window of the stream */
+    parser_window window;
+    /* Elements read so far */
+    size_t count;
+    enum items_state state;
+};
+
+static json_items *items_open(FILE *file, int fd)
+{
+    json_items *items = calloc(1, sizeof *items);
+
+    if (items != NULL)
+    {
+        items->file = file;
+        items->fd = fd;
+    }
+    return items;
+}
+
+json_items *json_items_open(FILE *file)
+{
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    return items_open(file, -1);
+}
+
+/* Not available on systems without read() */
+json_items *json_items_open_fd(int fd)
+{
+#ifdef ITEMS_FD
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    return items_open(NULL, fd);
+#else
+    (void)fd;
+    return NULL;
+#endif
+}
+
+/* Reads until the buffer is full (same as fread), returns 0 on fail */
+static int items_input(void *data, char *buf, size_t size, size_t *bytes)
+{
+    const json_items *items = data;
+
+#ifdef ITEMS_FD
+    if (items->file == NULL)
+    {
+        *bytes = 0;
+        while (*bytes < size)
+        {
+            ssize_t count = read(items->fd, buf + *bytes, size - *bytes);
+
+            if (count == 0)
+            {
+                break;
+            }
+            if (count == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return 0;
+            }
+            *bytes += (size_t)count;
+        }
+        return 1;
+    }
+#endif
+    *bytes = fread(buf, 1, size, items->file);
+    return (*bytes > 0) || !ferror(items->file);
+}
+
+/* Reads more text keeping the pending one, returns 0 at EOF, -1 on fail */
+static int items_fill(json_items *items)
+{
+    return parser_fill(&items->window, items_input, items);
+}
+
+static const char *skip_spaces(const char *str, const char *end)
+{
+    while ((str < end) && parser_is_space(*str))
+    {
+        str++;
+    }
+    return str;
+}
+
+/*
+ * The end of an element is found by bracket matching, the element is
+ * validated by the parser, skip_* functions return NULL when the window
+ * ends before the element
+ */
+
+static const char *skip_string(const char *str, const char *end)
+{
+    while ((str = simd_find_special(str, end)) < end)
+    {
+        switch (*str)
+        {
+            case '"':
+                return str + 1;
+            case '\\':
+                if (end - str < 2)
+                {
+                    return NULL;
+                }
+                str += 2;
+                break;
+            default:
+                /* Control character, rejected by the parser */
+                str++;
+                break;
+        }
+    }
+    return NULL;
+}
+
+static const char *skip_group(const char *str, const char *end)
+{
+    size_t depth = 1;
+
+    str++;
+    while ((str = simd_find_group(str, end)) < end)
+    {
+        switch (*str)
+        {
+            case '"':
+                str = skip_string(str + 1, end);
+                if (str == NULL)
+                {
+                    return NULL;
+                }
+                continue;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            default:
+                if (--depth == 0)
+                {
+                    return str + 1;
+                }
+                break;
+        }
+        str++;
+    }
+    return NULL;
+}
+
+static const char *skip_scalar(const char *str, const char *end)
+{
+    while (str < end)
+    {
+        if (parser_is_space(*str) || (*str == ',') || (*str == ']') ||
+            (*str == '}'))
+        {
+            return str;
+        }
+        str++;
+    }
+    return NULL;
+}
+
+static const char *skip_value(const char *str, const char *end)
+{
+    switch (*str)
+    {
+        case '{':
+        case '[':
+            return skip_group(str, end);
+        case '"':
+            return skip_string(str + 1, end);
+        default:
+            return skip_scalar(str, end);
+    }
+}
+
+/* Moves the head to end */
+static void consume(json_items *items, const char *end)
+{
+    items->window.head = (size_t)(end - items->window.text);
+}
+
+/* Unexpected character or end of the text at the head */
+static json *fail(json_items *items, json_error *error)
+{
+    if (error != NULL)
+    {
+        error->offset = items->window.offset + items->window.head;
+        error->code = JSON_ERROR_SYNTAX;
+    }
+    items->state = ITEMS_DONE;
+    return NULL;
+}
+
+/* The stream could not be read (or the window could not grow) */
+static json *fail_read(json_items *items, json_error *error)
+{
+    if (error != NULL)
+    {
+        error->offset = items->window.offset + items->window.length;
+        error->code = JSON_ERROR_READ;
+    }
+    items->state = ITEMS_DONE;
+    return NULL;
+}
+
+/* Parses the element from the head to end */
+static json *items_parse(json_items *items, const char *end,
+    json_error *error)
+{
+    parser_window *window = &items->window;
+    char *str = window->text + window->head;
+    json *node = parser_reuse(&items->arena, str, end, error);
+
+    if (node == NULL)
+    {
+        /* Make the offset relative to the stream */
+        if ((error != NULL) && (error->code != JSON_ERROR_NONE))
+        {
+            error->offset += window->offset + window->head;
+        }
+        items->state = ITEMS_DONE;
+        return NULL;
+    }
+    window->head = (size_t)(end - window->text);
+    items->state = ITEMS_COMMA;
+    items->count++;
+    return node;
+}
+
+/*
+ * Returns the tree of the next element, owned by the reader until the
+ * next call, NULL on a malformed text (error->code > 0), on a read
+ * error (JSON_ERROR_READ) or at the end (JSON_ERROR_NONE)
+ */
+json *json_items_read(json_items *items, json_error *error)
+{
+    parser_clear_error(error);
+    if (items == NULL)
+    {
+        return NULL;
+    }
+
+    const parser_window *window = &items->window;
+
+    while (items->state != ITEMS_DONE)
+    {
+        if (window->head == window->length)
+        {
+            int rc = items_fill(items);
+
+            if (rc < 0)
+            {
+                return fail_read(items, error);
+            }
+            if (rc == 0)
+            {
+                if (items->state != ITEMS_TAIL)
+                {
+                    return fail(items, error);
+                }
+                items->state = ITEMS_DONE;
+                return NULL;
+            }
+        }
+
+        const char *end = window->text + window->length;
+        const char *str = skip_spaces(window->text + window->head, end);
+
+        consume(items, str);
+        if (str == end)
+        {
+            continue;
+        }
+        switch (items->state)
+        {
+            case ITEMS_OPEN:
+                if (*str != '[')
+                {
+                    return fail(items, error);
+                }
+                consume(items, str + 1);
+                items->state = ITEMS_FIRST;
+                break;
+            case ITEMS_FIRST:
+                if (*str == ']')
+                {
+                    consume(items, str + 1);
+                    items->state = ITEMS_TAIL;
+                }
+                else
+                {
+                    items->state = ITEMS_VALUE;
+                }
+                break;
+            case ITEMS_COMMA:
+                if ((*str != ',') && (*str != ']'))
+                {
+                    return fail(items, error);
+                }
+                consume(items, str + 1);
+                items->state = *str == ',' ? ITEMS_VALUE : ITEMS_TAIL;
+                break;
+            case ITEMS_VALUE:
+            {
+                const char *next = skip_value(str, end);
+
+                if (next != NULL)
+                {
+                    return items_parse(items, next, error);
+                }
+                if (window->eof)
+                {
+                    /* Let the parser report the error */
+                    return items_parse(items, end, error);
+                }
+                if (items_fill(items) < 0)
+                {
+                    return fail_read(items, error);
+                }
+                break;
+            }
+            default:
+                /* Only spaces are allowed after the array */
+                return fail(items, error);
+        }
+    }
+    return NULL;
+}
+
+/* Number of elements read so far */
+size_t json_items_count(const json_items *items)
+{
+    return items ? items->count : 0;
+}
+
+/* The file is not closed */
+void json_items_close(json_items *items)
+{
+    if (items != NULL)
+    {
+        if (items->arena != NULL)
+        {
+            json_free(&items->arena->root);
+        }
+        free(items->window.text);
+        free(items);
+    }
+}
@@ -0,0 +1,506 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include "json_parser.h"
+#include "json_file.h"
+#include "json_simd.h"
+
+/* Minimum size of a slice, smaller texts are parsed on a single thread */
+#define PARALLEL_SLICE_SIZE (1024 * 1024)
+
+/*
+ * The elements of the top-level group are parsed in slices on a number
+ * of threads and linked under a single root afterwards:
+ * 1) The group is divided in chunks of the same size, each thread scans
+ *    a chunk in blocks of 64 bytes assuming that it starts out of a
+ *    string and inside a string
+ * 2) Once the state at the start of each chunk is known, each thread
+ *    looks for the first comma of the group from the start of its chunk
+ * 3) The elements between two commas are parsed into a slice
+ * Slices parsed without errors always build the same tree than the whole
+ * text, a malformed text is parsed again on the calling thread to report
+ * the error
+ */
+
+typedef struct parallel_slice parallel_slice;
+
+struct parallel_slice
+{
+    /* Task of the current stage */
+    void (*task)(parallel_slice *);
+    /* Text of the group and text of the chunk or the slice */
+    const char *text, *str, *end;
+    /*
+     * Quotes of the chunk (parity) and depth at its end assuming that it
+     * starts out of a string [0] or inside a string [1]
+     */
+    int quotes;
+    ptrdiff_t depth[2];
+    /* State at the start of the chunk and first comma from there */
+    int inside;
+    ptrdiff_t level;
+    const char *cut;
+    /* Final parent, node returned by the parser and its last child */
+    const json_options *options;
+    json *root, *top, *last;
+    size_t nodes;
+};
+
+/* Bit n is set when byte n follows a backslash escaping it */
+static uint64_t escaped(uint64_t backslash, uint64_t *carry)
+{
+    uint64_t bits = *carry;
+
+    *carry = 0;
+    backslash &= ~bits;
+    while (backslash != 0)
+    {
+        unsigned bit = simd_ctz(backslash);
+
+        if (bit == SIMD_BLOCK_SIZE - 1)
+        {
+            *carry = 1;
+            break;
+        }
+        bits |= (uint64_t)2 << bit;
+        backslash &= ~((uint64_t)3 << bit);
+    }
+    return bits;
+}
+
+/* Whether the first byte of a chunk is escaped (odd run of backslashes) */
+static uint64_t escape_carry(const char *text, const char *str)
+{
+    uint64_t carry = 0;
+
+    while ((str > text) && (*--str == '\\'))
+    {
+        carry ^= 1;
+    }
+    return carry;
+}
+
+/* Bits from an opening quote (included) to a closing quote (excluded) */
+static uint64_t strings(uint64_t quote)
+{
+    for (unsigned shift = 1; shift < SIMD_BLOCK_SIZE; shift *= 2)
+    {
+        quote ^= quote << shift;
+    }
+    return quote;
+}
+
+/* Marks a block, strings are computed as if it starts out of a string */
+static uint64_t scan_block(json_marks *marks, uint64_t *carry,
+    const char *str, const char *end)
+{
+    simd_mark(marks, str, end);
+    return strings(marks->quote & ~escaped(marks->escape, carry));
+}
+
+static ptrdiff_t balance(uint64_t open, uint64_t close)
+{
+    return (ptrdiff_t)simd_popcount(open) - (ptrdiff_t)simd_popcount(close);
+}
+
+/* Stage 1 */
+static void scan_chunk(parallel_slice *chunk)
+{
+    uint64_t carry = escape_carry(chunk->text, chunk->str);
+    uint64_t inside = 0;
+    ptrdiff_t out = 0, in = 0;
+
+    for (const char *str = chunk->str; str < chunk->end;
+         str += SIMD_BLOCK_SIZE)
+    {
+        json_marks marks;
+        uint64_t string = scan_block(&marks, &carry, str, chunk->end);
+
+        string ^= inside;
+        inside = 0 - (string >> (SIMD_BLOCK_SIZE - 1));
+        /* Starting inside a string the mask is the opposite */
+        out += balance(marks.open & ~string, marks.close & ~string);
+        in += balance(marks.open & string, marks.close & string);
+    }
+    chunk->quotes = inside != 0;
+    chunk->depth[0] = out;
+    chunk->depth[1] = in;
+}
+
+/* Stage 2, the comma can be in one of the next chunks */
+static void find_cut(parallel_slice *chunk)
+{
+    uint64_t carry = escape_carry(chunk->text, chunk->str);
+    uint64_t inside = chunk->inside ? ~(uint64_t)0 : 0;
+    ptrdiff_t depth = chunk->level;
+
+    chunk->cut = NULL;
+    for (const char *str = chunk->str; str < chunk->end;
+         str += SIMD_BLOCK_SIZE)
+    {
+        json_marks marks;
+        uint64_t string = scan_block(&marks, &carry, str, chunk->end);
+
+        string ^= inside;
+        inside = 0 - (string >> (SIMD_BLOCK_SIZE - 1));
+
+        uint64_t open = marks.open & ~string;
+        uint64_t close = marks.close & ~string;
+        uint64_t comma = marks.comma & ~string;
+
+        for (uint64_t mask = open | close | comma; mask != 0;
+             mask &= mask - 1)
+        {
+            uint64_t bit = mask & (0 - mask);
+
+            if (open & bit)
+            {
+                depth++;
+            }
+            else if (close & bit)
+            {
+                depth--;
+            }
+            else if (depth == 0)
+            {
+                chunk->cut = str + simd_ctz(bit);
+                return;
+            }
+        }
+    }
+}
+
+/* Stage 3 */
+static void parse_slice(parallel_slice *slice)
+{
+    slice->top = parser_slice(slice->root->type, slice->str, slice->end,
+        slice->options, &slice->nodes
+    );
+    if (slice->top != NULL)
+    {
+        for (json *node = slice->top->child; node != NULL; node = node->next)
+        {
+            node->parent = slice->root;
+            slice->last = node;
+        }
+    }
+}
+
+static int work(void *data)
+{
+    parallel_slice *slice = data;
+
+    slice->task(slice);
+    return 0;
+}
+
+/* Runs a task on threads, the first one on the calling thread */
+static void run(parallel_slice *slices, size_t count,
+    void (*task)(parallel_slice *))
+{
+    thrd_t *threads = malloc(count * sizeof *threads);
+    size_t running = 1;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        slices[i].task = task;
+    }
+    if (threads != NULL)
+    {
+        while ((running < count) &&
+               (thrd_create(&threads[running], work, &slices[running]) ==
+                thrd_success))
+        {
+            running++;
+        }
+    }
+    task(&slices[0]);
+    for (size_t i = 1; i < running; i++)
+    {
+        thrd_join(threads[i], NULL);
+    }
+    /* Not started */
+    for (size_t i = running; i < count; i++)
+    {
+        task(&slices[i]);
+    }
+    free(threads);
+}
+
+/*
+ * Cuts the elements of the group (from str to end, brackets excluded) in
+ * count slices at most, returns the number of slices or 0 when the
+ * quotes or the brackets don't match
+ */
+static size_t split(parallel_slice *slices, size_t count, const char *str,
+    const char *end)
+{
+    size_t size = (size_t)(end - str) / count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        slices[i].text = str;
+        slices[i].str = str + i * size;
+        slices[i].end = i + 1 < count ? str + (i + 1) * size : end;
+    }
+    run(slices, count, scan_chunk);
+
+    int inside = 0;
+    ptrdiff_t depth = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        slices[i].inside = inside;
+        slices[i].level = depth;
+        slices[i].end = end;
+        depth += slices[i].depth[inside];
+        inside ^= slices[i].quotes;
+    }
+    if ((depth != 0) || inside)
+    {
+        return 0;
+    }
+    run(slices + 1, count - 1, find_cut);
+
+    /* The cut of a slice is the comma before its first element */
+    size_t n = 0;
+
+    slices[0].cut = str - 1;
+    for (size_t i = 1; i < count; i++)
+    {
+        const char *cut = slices[i].cut;
+
+        /* Chunks without commas of their own join the previous slice */
+        if ((cut != NULL) && (cut > slices[n].cut))
+        {
+            slices[n].str = slices[n].cut + 1;
+            slices[n].end = cut;
+            slices[++n].cut = cut;
+        }
+    }
+    slices[n].str = slices[n].cut + 1;
+    slices[n].end = end;
+    return n + 1;
+}
+
+/* Gives the elements back to the node of the slice and releases it */
+static void discard(parallel_slice *slice)
+{
+    if (slice->top != NULL)
+    {
+        for (json *node = slice->top->child; node != NULL; node = node->next)
+        {
+            node->parent = slice->top;
+        }
+        json_free(slice->top);
+    }
+}
+
+/* Moves the elements of the slices to the root and releases the slices */
+static void join(parallel_slice *slices, size_t count, json *root)
+{
+    json *last = NULL;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        json *top = slices[i].top;
+
+        if (last == NULL)
+        {
+            root->child = top->child;
+        }
+        else
+        {
+            last->next = top->child;
+            top->child->prev = last;
+        }
+        last = slices[i].last;
+        top->child = NULL;
+        if (top->flags & JSON_DOCUMENT)
+        {
+            arena_merge((json_arena *)(void *)root,
+                (json_arena *)(void *)top
+            );
+        }
+        else
+        {
+            json_free(top);
+        }
+    }
+}
+
+static json *new_root(const json_options *options, enum json_type type)
+{
+    json *root;
+
+    if (options->flags & JSON_PARSE_ARENA)
+    {
+        json_arena *arena = arena_create(0);
+
+        root = arena ? &arena->root : NULL;
+    }
+    else
+    {
+        root = calloc(1, sizeof *root);
+    }
+    if (root != NULL)
+    {
+        root->type = type;
+    }
+    return root;
+}
+
+/* Returns the root or NULL when the text must be parsed on one thread */
+static json *parse_slices(parallel_slice *slices, size_t count,
+    const char *str, const char *end, const json_options *options)
+{
+    json *root = new_root(options, *str == '{' ? JSON_OBJECT : JSON_ARRAY);
+
+    if (root == NULL)
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        slices[i].options = options;
+        slices[i].root = root;
+    }
+    /* Brackets of the group are left out */
+    count = split(slices, count, str + 1, end - 1);
+    if (count < 2)
+    {
+        json_free(root);
+        return NULL;
+    }
+    run(slices, count, parse_slice);
+
+    /* The root is a node too */
+    size_t nodes = 1;
+    int failed = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        failed |= slices[i].top == NULL;
+        nodes += slices[i].nodes;
+    }
+    if (failed || ((options->max_nodes > 0) && (nodes > options->max_nodes)))
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            discard(&slices[i]);
+        }
+        json_free(root);
+        return NULL;
+    }
+    join(slices, count, root);
+    return root;
+}
+
+/* Whether the options can be honored parsing the elements apart */
+static int can_split(const char *str, const char *end,
+    const json_options *options)
+{
+    /* Names are interned per document */
+    if (options->flags & JSON_PARSE_INTERN)
+    {
+        return 0;
+    }
+    /* Names of the root object are checked as a whole */
+    if ((*str == '{') && (options->flags &
+        (JSON_PARSE_UNIQUE | JSON_PARSE_KEEP_FIRST | JSON_PARSE_KEEP_LAST)))
+    {
+        return 0;
+    }
+    return (end - str >= 2) && (((*str == '{') && (end[-1] == '}')) ||
+                                ((*str == '[') && (end[-1] == ']')));
+}
+
+static json *parse(const char *str, const char *end,
+    const json_options *options, unsigned threads, json_error *error)
+{
+    json_options defaults = {0};
+
+    options = options ? options : &defaults;
+
+    size_t count = (size_t)(end - str) / PARALLEL_SLICE_SIZE;
+    const char *first = str;
+    const char *last = end;
+
+    while ((first < last) && parser_is_space(*first))
+    {
+        first++;
+    }
+    while ((last > first) && parser_is_space(last[-1]))
+    {
+        last--;
+    }
+    count = count < threads ? count : threads;
+    /* The limit of bytes is reported by the parser */
+    if ((options->max_bytes > 0) && ((size_t)(end - str) > options->max_bytes))
+    {
+        count = 0;
+    }
+    if ((count > 1) && can_split(first, last, options))
+    {
+        parallel_slice *slices = calloc(count, sizeof *slices);
+
+        if (slices != NULL)
+        {
+            json *root = parse_slices(slices, count, first, last, options);
+
+            free(slices);
+            if (root != NULL)
+            {
+                parser_clear_error(error);
+                return root;
+            }
+        }
+    }
+    return parser_parse(str, end, options, error);
+}
+
+/*
+ * Parses a document whose top-level group is big enough on a number of
+ * threads, the tree is the same than the one built by json_parse_options
+ */
+json *json_parse_parallel(const char *str, const json_options *options,
+    unsigned threads, json_error *error)
+{
+    if (str == NULL)
+    {
+        parser_clear_error(error);
+        return NULL;
+    }
+    return parse(str, str + strlen(str), options, threads, error);
+}
+
+/* Same as json_parse_file_options with JSON_PARSE_ARENA */
+json *json_parse_file_parallel(const char *path, unsigned threads,
+    json_error *error)
+{
+    json_file file;
+
+    if (!file_load(&file, path))
+    {
+        parser_clear_error(error);
+        if (error != NULL)
+        {
+            error->code = JSON_ERROR_READ;
+        }
+        return NULL;
+    }
+
+    json_options options = {.flags = JSON_PARSE_ARENA};
+    json *node = parse(file.text, file.text + file.size, &options, threads,
+        error
+    );
+
+    file_release(&file);
+    return node;
+}
@@ -5,11 +5,103 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
-#include "json_struct.h"
+#include "json_arena.h"
+#include "json_file.h"
+#include "json_number.h"
+#include "json_parser.h"
+#include "json_simd.h"
+#include "json_utf8.h"
 #include "json_macros.h"
 
+/* Open addressing set of the members of an object */
+typedef struct
+{
+    json *node;
+    uint64_t hash;
+} json_member;
+
+typedef struct
+{
+    const json *object;
+    json_member *slots;
+    size_t size, count;
+    unsigned bits;
+} json_names;
+
+/* Members searched linearly before hashing the names of an object */
+#define NAMES_LINEAR 8
+
+struct json_parser
+{
+    json_arena *arena;
+    /* Text and structural index of the current block */
+    const char *end;
+    json_block block;
+    /* The last scanned string contains escape sequences */
+    int escaped;
+    /* Names and strings point into the text */
+    int insitu;
+    /* Push parser: more text can follow the current one */
+    int partial;
+    /* Push parser: where parse() stopped waiting for more text */
+    json *root, *node;
+    const char *resume;
+    /* Push parser: incomplete element at the end of the last chunk */
+    char *carry;
+    size_t carry_length, carry_size;
+    /* Push parser: length of the carry worth parsing again */
+    size_t carry_retry;
+    /* Push parser: bytes fed */
+    size_t bytes;
+    /* Push parser: names and strings are validated as they are scanned */
+    int utf8;
+    /* Push parser: bytes before the text being parsed */
+    size_t offset;
+    json_error error;
+    /* Limits and flags, elements and depth of the current element */
+    json_options options;
+    size_t nodes, depth;
+    /* Limit exceeded */
+    enum json_error_code limit;
+    /* Event parser: callback, user data and buffer for string values */
+    json_event_callback callback;
+    void *data;
+    int stopped;
+    char *scratch;
+    size_t scratch_size;
+    /* Names of the wide objects being parsed, one per depth */
+    json_names *names;
+    size_t names_size;
+    /* Member of the previous object at the same position, per depth */
+    json **shapes;
+    size_t shapes_size;
+    /* Group whose elements are parsed, NULL when parsing a document */
+    json *top;
+    /* Validator: nodes of the first levels, nothing is copied */
+    int validate;
+    struct json_level *levels;
+    size_t levels_count, levels_size;
+};
+
+/*
+ * An event parser reuses a single node per depth level, each one with
+ * its own buffer for names
+ */
+typedef struct json_level
+{
+    json node; // Must be the first member
+    char *name;
+    size_t size;
+    /* Elements already parsed in the current group */
+    size_t count;
+} json_level;
+
+/* Levels of a validator before allocating nodes (deeper documents) */
+#define VALID_LEVELS 64
+
 /* Returns the type of an iterable by token */
 static enum json_type token_type(int token)
 {
@@ -65,7 +157,7 @@ static int unicode_to_mb(const char *str, char *buf)
     /* Copy "as is" if is not a valid json character */
     if (!is_char(codepoint))
     {
-        memcpy(buf, str - 1, 6);
+        memmove(buf, str - 1, 6);
         return 6;
     }
     /* Convert to multibyte and return the length */
@@ -89,91 +181,125 @@ static int unicode_to_mb(const char *str, char *buf)
     }
 }
 
+/* Returns the character at str or '\0' past the end of the text */
+static int at(const json_parser *parser, const char *str)
+{
+    return str < parser->end ? *str : '\0';
+}
+
 /* scan() helpers */
 
-static const char *scan_quoted(const char *str)
+/* Skips spaces or the contents of an unquoted scalar using the index */
+static const char *scan_block(json_parser *parser, const char *str, int spaces)
 {
-    while (!is_cntrl(*str))
+    json_block *block = &parser->block;
+
+    while (1)
     {
-        if (*str == '"')
+        size_t offset = (size_t)(str - block->base);
+
+        if (offset >= SIMD_BLOCK_SIZE)
         {
-            break;
+            simd_classify(block, str, parser->end);
+            offset = 0;
         }
-        if (*str == '\\')
+
+        uint64_t mask = (spaces ? ~block->space : block->delim) >> offset;
+
+        if (mask != 0)
         {
-            if (is_escape(str + 1))
-            {
-                str += 2;
-                continue;
-            }
-            if (is_unicode(str + 1))
-            {
-                str += 6;
-                continue;
-            }
-            break;
+            return str + simd_ctz(mask);
         }
-        str++;
+        str += SIMD_BLOCK_SIZE - offset;
     }
-    return str;
 }
 
-static const char *scan_unquoted(const char *str)
+static const char *scan_spaces(json_parser *parser, const char *str)
+{
+    return scan_block(parser, str, 1);
+}
+
+static const char *scan_unquoted(json_parser *parser, const char *str)
 {
-    while (!is_space(*str) && !is_token(*str))
+    return scan_block(parser, str, 0);
+}
+
+static const char *scan_quoted(json_parser *parser, const char *str)
+{
+    const char *end = parser->end;
+
+    parser->escaped = 0;
+    /* Skip clean runs until a quote, a backslash or a control character */
+    while ((str = simd_find_special(str, end)) < end)
     {
-        if (*str == '"')
+        if (*str != '\\')
         {
             break;
         }
-        str++;
+        if ((end - str > 1) && is_escape(str + 1))
+        {
+            str += 2;
+        }
+        else if ((end - str > 5) && is_unicode(str + 1))
+        {
+            str += 6;
+        }
+        else
+        {
+            break;
+        }
+        parser->escaped = 1;
     }
     return str;
 }
 
 /* Returns a pointer to the next element or NULL on fail */
-static const char *scan(const char **left, const char **right)
+static const char *scan(json_parser *parser,
+    const char **left, const char **right)
 {
-    const char *str = *left;
-
     /* Skip leading spaces */
-    while (is_space(*str))
-    {
-        str++;
-    }
+    const char *str = scan_spaces(parser, *left);
+
     /* Adjust pointers to token */
     *left = *right = str;
     /* Return on first token */
-    if (is_token(*str))
+    if (is_token(at(parser, str)))
     {
         return str;
     }
     /* Handle name or string scalar */
     if (*str == '"')
     {
-        str = scan_quoted(str + 1);
-        if (*str != '"')
+        str = scan_quoted(parser, str + 1);
+        if (at(parser, str) != '"')
         {
             goto fail;
         }
+        if (parser->utf8)
+        {
+            const char *bad = utf8_validate(*left + 1, str);
+
+            if (bad != str)
+            {
+                str = bad;
+                goto fail;
+            }
+        }
         *right = str++;
     }
     else // ... handle other scalars
     {
-        str = scan_unquoted(str + 1);
-        if (*str == '"')
+        str = scan_unquoted(parser, str + 1);
+        if (at(parser, str) == '"')
         {
             goto fail;
         }
         *right = str - 1;
     }
     /* Skip trailing spaces */
-    while (is_space(*str))
-    {
-        str++;
-    }
+    str = scan_spaces(parser, str);
     /* Unexpected character */
-    if (!is_token(*str))
+    if (!is_token(at(parser, str)))
     {
         goto fail;
     }
@@ -185,94 +311,236 @@ fail:
     return NULL;
 }
 
-/* Allocates space for a name or a string value escaping special characters */
-static char *copy(const char *str, size_t length)
+/*
+ * Copies a string to buf escaping special characters
+ * Returns a pointer to the end of the copy
+ * buf can point to the string itself (unescaping only shrinks the text)
+ */
+static char *unescape(char *buf, const char *str, const char *end)
 {
-    char *buf = malloc(length + 1);
-
-    if (buf == NULL)
-    {
-        return NULL;
-    }
-
-    const char *end = str + length;
-    char *ptr = buf;
-
     while (str < end)
     {
-        if (*str == '\\')
+        /* Bulk copy the run before the next escape sequence */
+        const char *esc = memchr(str, '\\', (size_t)(end - str));
+        size_t run = (size_t)((esc ? esc : end) - str);
+
+        memmove(buf, str, run);
+        buf += run;
+        str += run;
+        if (str == end)
         {
-            switch (*++str)
-            {
-                default : *ptr++ = *str; break;
-                case 'b': *ptr++ = '\b'; break;
-                case 'f': *ptr++ = '\f'; break;
-                case 'n': *ptr++ = '\n'; break;
-                case 'r': *ptr++ = '\r'; break;
-                case 't': *ptr++ = '\t'; break;
-                case 'u':
-                    ptr += unicode_to_mb(str, ptr);
-                    str += 4;
-                    break;
-            }
+            break;
         }
-        else
+        switch (*++str)
         {
-            *ptr++ = *str;
+            default : *buf++ = *str; break;
+            case 'b': *buf++ = '\b'; break;
+            case 'f': *buf++ = '\f'; break;
+            case 'n': *buf++ = '\n'; break;
+            case 'r': *buf++ = '\r'; break;
+            case 't': *buf++ = '\t'; break;
+            case 'u':
+                buf += unicode_to_mb(str, buf);
+                str += 4;
+                break;
         }
         str++;
     }
-    *ptr = '\0';
     return buf;
 }
 
-/* Convert and check whether a string is a valid number */
-static double to_number(const char *left, const char *right, int *error)
+/* Length of a name or a string of a parsed text, up to its closing quote */
+static size_t quoted_length(const char *str, int *escaped)
 {
-    char *end;
-    double number = strtod(left, &end);
+    const char *ptr = str;
 
-    if (end <= right)
+    while (*ptr != '"')
     {
-        *error = 1;
-        return 0;
+        if (*ptr == '\\')
+        {
+            *escaped = 1;
+            ptr++;
+        }
+        ptr++;
     }
-    /* Skip sign */
-    if (left[0] == '-')
+    return (size_t)(ptr - str);
+}
+
+/* Allocates space for a name or a string value escaping special characters */
+static char *copy(json_parser *parser, const char *str, size_t length)
+{
+    if (parser->insitu)
     {
-        left++;
+        /*
+         * Closed by its quote until the text is parsed, terminators and
+         * escape sequences are left for the end, so that the text is
+         * intact if the parse fails
+         */
+        return (char *)(uintptr_t)str;
     }
-    /* Do not allow padding 0s */
-    if ((left[0] == '0') && is_digit(left[1]))
+
+    char *buf = parser->arena
+        ? arena_string(parser->arena, length + 1)
+        : malloc(length + 1);
+
+    if (buf == NULL)
     {
-        *error = 1;
-        return 0;
+        return NULL;
+    }
+
+    char *ptr = buf;
+
+    if (!parser->escaped)
+    {
+        memcpy(ptr, str, length);
+        ptr += length;
     }
-    /* Must start and end with a digit */ 
-    if (!is_digit(*left) || !is_digit(*right))
+    else
     {
-        *error = 1;
-        return 0;
+        ptr = unescape(ptr, str, str + length);
     }
-    *error = 0;
-    return number;
+    *ptr = '\0';
+    if (parser->arena != NULL)
+    {
+        arena_trim(parser->arena, ptr + 1);
+    }
+    return buf;
 }
 
-/* Check whether a string already tested as a valid number is a double */
-static int is_double(const char *left, const char *right)
+/* Copies a name or a string value to a reusable buffer (event parser) */
+static char *reuse(json_parser *parser, char **buf, size_t *size,
+    const char *str, size_t length)
 {
-    while (left <= right)
+    if (length >= *size)
     {
-        if ((*left == '.') || (*left == 'E') || (*left == 'e'))
+        size_t next = *size ? *size : 32;
+
+        while (next <= length)
+        {
+            next *= 2;
+        }
+
+        char *temp = realloc(*buf, next);
+
+        if (temp == NULL)
         {
-            return 1;
+            return NULL;
         }
-        left++;
+        *buf = temp;
+        *size = next;
+    }
+
+    char *end = parser->escaped
+        ? unescape(*buf, str, str + length)
+        : (char *)memcpy(*buf, str, length) + length;
+
+    *end = '\0';
+    return *buf;
+}
+
+/* Limits of the options, they return 0 when a limit is exceeded */
+
+static int exceeds(json_parser *parser, size_t max, size_t value,
+    enum json_error_code code)
+{
+    if ((max > 0) && (value > max))
+    {
+        parser->limit = code;
+        return 1;
     }
     return 0;
 }
 
-static char *set_name(json *node, const char *left, const char *right)
+static int add_node(json_parser *parser)
+{
+    return !exceeds(parser, parser->options.max_nodes, ++parser->nodes,
+        JSON_ERROR_NODES
+    );
+}
+
+static int add_depth(json_parser *parser)
+{
+    return !exceeds(parser, parser->options.max_depth, ++parser->depth,
+        JSON_ERROR_DEPTH
+    );
+}
+
+/* Quotes are included */
+static int check_string(json_parser *parser, size_t length)
+{
+    return !exceeds(parser, parser->options.max_string, length - 2,
+        JSON_ERROR_STRING
+    );
+}
+
+/*
+ * Records repeat the same names in the same order, an arena tree shares
+ * the name of the member at the same position of the previous object
+ */
+
+static int use_shapes(const json_parser *parser)
+{
+    return (parser->arena != NULL) && !parser->insitu &&
+        (parser->callback == NULL);
+}
+
+/* A group is opened at the current depth */
+static int start_shape(json_parser *parser, const json *group)
+{
+    if (parser->depth >= parser->shapes_size)
+    {
+        size_t size = parser->depth * 2;
+        json **shapes = realloc(parser->shapes, size * sizeof *shapes);
+
+        if (shapes == NULL)
+        {
+            return 0;
+        }
+        parser->shapes = shapes;
+        parser->shapes_size = size;
+    }
+
+    const json *prev = group->prev;
+
+    parser->shapes[parser->depth] = (group->type == JSON_OBJECT) &&
+        (prev != NULL) && (prev->type == JSON_OBJECT) ? prev->child : NULL;
+    return 1;
+}
+
+/* The next member of the current group follows */
+static void next_shape(json_parser *parser)
+{
+    json **shape = &parser->shapes[parser->depth];
+
+    *shape = *shape ? (*shape)->next : NULL;
+}
+
+/* Shares the name of the previous object when it is the same */
+static int share_name(const json_parser *parser, json *node,
+    const char *str, size_t length)
+{
+    const json *shape = parser->shapes[parser->depth];
+
+    if ((shape == NULL) || parser->escaped ||
+        (strncmp(shape->name, str, length) != 0) ||
+        (shape->name[length] != '\0'))
+    {
+        return 0;
+    }
+    node->name = shape->name;
+    node->flags |= JSON_SHARED_NAME | (shape->flags & JSON_INTERNED_NAME);
+    return 1;
+}
+
+static void free_shapes(json_parser *parser)
+{
+    free(parser->shapes);
+    parser->shapes = NULL;
+    parser->shapes_size = 0;
+}
+
+static char *set_name(json_parser *parser, json *node,
+    const char *left, const char *right)
 {
     size_t length = (size_t)(right - left + 1);
 
@@ -281,23 +549,101 @@ static char *set_name(json *node, const char *left, const char *right)
     {
         return NULL;
     }
+    if (!check_string(parser, length))
+    {
+        return NULL;
+    }
+    /* Only the presence of the name matters to a validator */
+    if (parser->validate)
+    {
+        return node->name = (char *)(uintptr_t)(left + 1);
+    }
     /* Allocate memory skipping quotes */
-    node->name = copy(left + 1, length - 2);
+    if (parser->callback != NULL)
+    {
+        json_level *level = (json_level *)(void *)node;
+
+        return node->name = reuse(parser, &level->name, &level->size,
+            left + 1, length - 2
+        );
+    }
+    if (use_shapes(parser) && share_name(parser, node, left + 1, length - 2))
+    {
+        return node->name;
+    }
+    node->name = copy(parser, left + 1, length - 2);
+    if ((parser->arena != NULL) || parser->insitu)
+    {
+        node->flags |= JSON_SHARED_NAME;
+    }
+    if ((node->name != NULL) && (parser->arena != NULL) &&
+        (parser->arena->names != NULL))
+    {
+        node->name = arena_intern(parser->arena, node->name);
+        node->flags |= JSON_INTERNED_NAME;
+    }
     return node->name;
 }
 
-static int set_value(json *node, const char *left, const char *right)
+/* Keeps the text of a double to be converted on demand */
+static int set_number_text(json_parser *parser, json *node,
+    const char *str, size_t length)
+{
+    char *buf = parser->arena
+        ? arena_string(parser->arena, length + 1)
+        : malloc(length + 1);
+
+    if (buf == NULL)
+    {
+        return 0;
+    }
+    memcpy(buf, str, length);
+    buf[length] = '\0';
+    node->value.string = buf;
+    node->flags |= JSON_NUMBER_TEXT;
+    if (parser->arena != NULL)
+    {
+        node->flags |= JSON_SHARED_STRING;
+    }
+    return 1;
+}
+
+static int set_value(json_parser *parser, json *node,
+    const char *left, const char *right)
 {
     size_t length = (size_t)(right - left + 1);
     int error = 0;
 
+    if (!add_node(parser))
+    {
+        return 0;
+    }
     if ((*left == '"') && (*right == '"'))
     {
+        if (!check_string(parser, length))
+        {
+            return 0;
+        }
         node->type = JSON_STRING;
-        if (!(node->value.string = copy(left + 1, length - 2)))
+        if (parser->validate)
+        {
+            node->value.string = NULL;
+        }
+        else if (parser->callback != NULL)
+        {
+            node->value.string = reuse(parser,
+                &parser->scratch, &parser->scratch_size, left + 1, length - 2
+            );
+            error = node->value.string == NULL;
+        }
+        else if (!(node->value.string = copy(parser, left + 1, length - 2)))
         {
             error = 1;
         }
+        else if ((parser->arena != NULL) || parser->insitu)
+        {
+            node->flags |= JSON_SHARED_STRING;
+        }
     }
     else if ((length == 4) && (strncmp(left, "null", length) == 0))
     {
@@ -314,29 +660,102 @@ static int set_value(json *node, const char *left, const char *right)
         node->type = JSON_BOOLEAN;
         node->value.number = 0;
     }
-    else
+    else if ((parser->options.flags & JSON_PARSE_LAZY) &&
+             (parser->callback == NULL))
+    {
+        error = !number_scan(node, left, right + 1) ||
+            ((node->type == JSON_DOUBLE) &&
+             !set_number_text(parser, node, left, length));
+    }
+    else if (!number_parse(node, left, right + 1))
+    {
+        error = 1;
+    }
+    return !error;
+}
+
+/* Takes the node of the next level from the pool of a validator */
+static json *level_node(json_parser *parser)
+{
+    json_level *level = &parser->levels[parser->levels_count++];
+
+    memset(level, 0, sizeof *level);
+    return &level->node;
+}
+
+/* Event parsers and validators reuse a single node per depth level */
+static int by_levels(const json_parser *parser)
+{
+    return (parser->callback != NULL) || parser->validate;
+}
+
+static json *new_node(json_parser *parser)
+{
+    if (parser->arena != NULL)
+    {
+        return arena_node(parser->arena);
+    }
+    if (by_levels(parser))
     {
-        double value = to_number(left, right, &error);
+        json *node = parser->levels_count < parser->levels_size
+            ? level_node(parser)
+            : calloc(1, sizeof(json_level));
 
-        if (!error)
+        /* Names and strings are owned by the parser */
+        if (node != NULL)
         {
-            node->type = is_double(left, right) ? JSON_DOUBLE : JSON_INTEGER;
-            node->value.number = value;
+            node->flags = JSON_SHARED_NAME | JSON_SHARED_STRING;
         }
+        return node;
     }
-    return !error;
+    return calloc(1, sizeof(struct json));
 }
 
-static json *create_node(void)
+/* Prepares the node of a level for the next element (event parser) */
+static json *reset_node(json *node)
 {
-    return calloc(1, sizeof(struct json));
+    node->name = NULL;
+    node->value.real = 0;
+    node->type = JSON_UNDEFINED;
+    node->flags = JSON_SHARED_NAME | JSON_SHARED_STRING;
+    ((json_level *)(void *)node)->count++;
+    return node;
+}
+
+static json *create_node(json_parser *parser, size_t length, unsigned flags)
+{
+    if (flags & (JSON_PARSE_ARENA | JSON_PARSE_INTERN))
+    {
+        /* Room for nodes and strings grows with the size of the text */
+        json_arena *arena = arena_create(length * 2);
+
+        if ((arena != NULL) && (flags & JSON_PARSE_INTERN) && !parser->insitu)
+        {
+            arena->names = json_map_create(0);
+            if (arena->names == NULL)
+            {
+                arena_destroy(arena);
+                arena = NULL;
+            }
+        }
+        parser->arena = arena;
+        return arena ? &arena->root : NULL;
+    }
+    return new_node(parser);
 }
 
 /* parse() helpers - node must exist */
 
-static json *create_child(json *parent)
+static json *create_child(json_parser *parser, json *parent)
 {
-    json *child = calloc(1, sizeof(struct json));
+    if (by_levels(parser) && (parent->child != NULL))
+    {
+        reset_node(parent->child);
+        ((json_level *)(void *)parent->child)->count = 0;
+        return parent->child;
+    }
+
+    json *child = new_node(parser);
 
     if (child != NULL)
     {
@@ -346,16 +765,30 @@ static json *create_child(json *parent)
     return child;
 }
 
-static json *delete_child(json *parent)
+static json *delete_child(json_parser *parser, json *parent)
 {
-    free(parent->child);
+    /* The node of the level is kept for the next group */
+    if (by_levels(parser))
+    {
+        return parent;
+    }
+    /* Arena nodes are released with the document */
+    if (parser->arena == NULL)
+    {
+        free(parent->child);
+    }
     parent->child = NULL;
     return parent;
 }
 
-static json *create_next(json *node)
+static json *create_next(json_parser *parser, json *node)
 {
-    json *next = calloc(1, sizeof(struct json));
+    if (by_levels(parser))
+    {
+        return reset_node(node);
+    }
+
+    json *next = new_node(parser);
 
     if (next != NULL)
     {
@@ -366,25 +799,387 @@ static json *create_next(json *node)
     return next;
 }
 
-/* Parse document - returns an error position or NULL on success */
-static const char *parse(json *node, const char *left)
+/* Whether node is the first element of a group */
+static int is_first(const json_parser *parser, const json *node)
 {
-    const char *right = NULL;
-    const char *token;
+    if (by_levels(parser))
+    {
+        return ((const json_level *)(const void *)node)->count == 0;
+    }
+    return node->prev == NULL;
+}
 
-    while (node != NULL)
+/*
+ * Duplicate names (JSON_PARSE_UNIQUE / KEEP_FIRST / KEEP_LAST), the
+ * first members of an object are searched linearly, the names of wider
+ * objects are hashed in the set of its depth
+ */
+
+static int check_names(const json_parser *parser)
+{
+    return (parser->callback == NULL) && (parser->options.flags &
+        (JSON_PARSE_UNIQUE | JSON_PARSE_KEEP_FIRST | JSON_PARSE_KEEP_LAST));
+}
+
+/*
+ * In-situ names are closed by their quotes until the end, returns an
+ * unescaped copy of the escaped ones, the length is stored in length
+ */
+static char *plain_name(const json_parser *parser, const char *name,
+    size_t *length)
+{
+    if (!parser->insitu)
     {
-        if (!(token = scan(&left, &right)))
-        {
-            return left;
-        }
-        switch (*token)
-        {
-            case '{':
-            case '[':
-                /* Commas between groups are required: [[] []] */
-                if (node->type != JSON_UNDEFINED)
-                {
+        *length = strlen(name);
+        return NULL;
+    }
+
+    int escaped = 0;
+
+    *length = quoted_length(name, &escaped);
+    if (!escaped)
+    {
+        return NULL;
+    }
+
+    char *buf = malloc(*length + 1);
+
+    if (buf != NULL)
+    {
+        char *end = unescape(buf, name, name + *length);
+
+        *end = '\0';
+        *length = (size_t)(end - buf);
+    }
+    return buf;
+}
+
+static int same_name(const json_parser *parser, const char *a,
+    const char *b)
+{
+    if (!parser->insitu)
+    {
+        return strcmp(a, b) == 0;
+    }
+
+    size_t x_length, y_length;
+    char *x = plain_name(parser, a, &x_length);
+    char *y = plain_name(parser, b, &y_length);
+    int result = (x_length == y_length) &&
+        (memcmp(x ? x : a, y ? y : b, x_length) == 0);
+
+    free(x);
+    free(y);
+    return result;
+}
+
+static uint64_t hash_name(const json_parser *parser, const char *name)
+{
+    size_t length;
+    char *buf = plain_name(parser, name, &length);
+    const unsigned char *str = (const unsigned char *)(buf ? buf : name);
+    uint64_t hash = 5381;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = hash * 33 + str[i];
+    }
+    free(buf);
+    return hash;
+}
+
+/* Slot holding a member named name or the empty slot where it goes */
+static json_member *names_slot(const json_parser *parser,
+    const json_names *names, const char *name, uint64_t hash)
+{
+    /* Fibonacci hashing, the high bits are the best mixed */
+    size_t mask = names->size - 1;
+    size_t index = (size_t)((hash * UINT64_C(0x9E3779B97F4A7C15)) >>
+        (64 - names->bits)
+    );
+
+    while ((names->slots[index].node != NULL) &&
+           ((names->slots[index].hash != hash) ||
+            !same_name(parser, names->slots[index].node->name, name)))
+    {
+        index = (index + 1) & mask;
+    }
+    return &names->slots[index];
+}
+
+/* Keeps the load factor under 1/2 */
+static int names_add(const json_parser *parser, json_names *names,
+    json *node, uint64_t hash)
+{
+    if ((names->count + 1) * 2 > names->size)
+    {
+        json_names next = {names->object, NULL, 0, 0, names->bits + 1};
+
+        next.bits = next.bits > 1 ? next.bits : 5;
+        next.size = (size_t)1 << next.bits;
+        next.slots = calloc(next.size, sizeof *next.slots);
+        if (next.slots == NULL)
+        {
+            return 0;
+        }
+        for (size_t i = 0; i < names->size; i++)
+        {
+            json_member *name = &names->slots[i];
+
+            if (name->node != NULL)
+            {
+                *names_slot(parser, &next, name->node->name, name->hash) =
+                    *name;
+                next.count++;
+            }
+        }
+        free(names->slots);
+        *names = next;
+    }
+
+    json_member *slot = names_slot(parser, names, node->name, hash);
+
+    slot->node = node;
+    slot->hash = hash;
+    names->count++;
+    return 1;
+}
+
+/* Set of the object at the current depth */
+static json_names *get_names(json_parser *parser)
+{
+    if (parser->depth >= parser->names_size)
+    {
+        size_t size = parser->depth * 2;
+        json_names *names = realloc(parser->names, size * sizeof *names);
+
+        if (names == NULL)
+        {
+            return NULL;
+        }
+        memset(names + parser->names_size, 0,
+            (size - parser->names_size) * sizeof *names
+        );
+        parser->names = names;
+        parser->names_size = size;
+    }
+    return &parser->names[parser->depth];
+}
+
+/* Empties the set of an object once parsed, the slots are kept */
+static void clear_names(json_parser *parser, const json *object)
+{
+    if ((parser->depth < parser->names_size) &&
+        (parser->names[parser->depth].object == object))
+    {
+        json_names *names = &parser->names[parser->depth];
+
+        memset(names->slots, 0, names->size * sizeof *names->slots);
+        names->object = NULL;
+        names->count = 0;
+    }
+}
+
+static void free_names(json_parser *parser)
+{
+    for (size_t i = 0; i < parser->names_size; i++)
+    {
+        free(parser->names[i].slots);
+    }
+    free(parser->names);
+    parser->names = NULL;
+    parser->names_size = 0;
+}
+
+/*
+ * Looks for a member before node with the same name, returns its slot
+ * in the set of the object (or a stack slot for small objects) with a
+ * NULL node when there is none, returns NULL on fail
+ */
+static json_member *find_name(json_parser *parser, json *node,
+    json_member *found)
+{
+    json_names *names = parser->depth < parser->names_size
+        ? &parser->names[parser->depth]
+        : NULL;
+
+    found->node = NULL;
+    if ((names == NULL) || (names->object != node->parent))
+    {
+        json *prev = node->prev;
+
+        for (int i = 0; (prev != NULL) && (i < NAMES_LINEAR); i++)
+        {
+            if (same_name(parser, prev->name, node->name))
+            {
+                found->node = prev;
+                return found;
+            }
+            prev = prev->prev;
+        }
+        if (prev == NULL)
+        {
+            return found;
+        }
+        /* Members before node are unique, hash them all */
+        if ((names = get_names(parser)) == NULL)
+        {
+            return NULL;
+        }
+        names->object = node->parent;
+        for (prev = node->prev; prev != NULL; prev = prev->prev)
+        {
+            if (!names_add(parser, names, prev, hash_name(parser, prev->name)))
+            {
+                return NULL;
+            }
+        }
+    }
+
+    uint64_t hash = hash_name(parser, node->name);
+    json_member *slot = names_slot(parser, names, node->name, hash);
+
+    if (slot->node != NULL)
+    {
+        return slot;
+    }
+    return names_add(parser, names, node, hash) ? found : NULL;
+}
+
+/* Applies the policy for a member whose name was just set */
+static int unique_name(json_parser *parser, json *node)
+{
+    json_member temp;
+    json_member *slot = find_name(parser, node, &temp);
+
+    if (slot == NULL)
+    {
+        return 0;
+    }
+
+    json *found = slot->node;
+
+    if (found == NULL)
+    {
+        return 1;
+    }
+    if (parser->options.flags & JSON_PARSE_UNIQUE)
+    {
+        parser->limit = JSON_ERROR_DUPLICATE;
+        return 0;
+    }
+    if (parser->options.flags & JSON_PARSE_KEEP_FIRST)
+    {
+        /* Dropped once its value is parsed */
+        node->flags |= JSON_DUPLICATE;
+        return 1;
+    }
+    slot->node = node;
+    json_delete(found);
+    return 1;
+}
+
+/* Returns the node before a member dropped by JSON_PARSE_KEEP_FIRST */
+static json *drop_name(json *node)
+{
+    if (node->flags & JSON_DUPLICATE)
+    {
+        json *prev = node->prev;
+
+        json_delete(node);
+        return prev;
+    }
+    return node;
+}
+
+/* Event for a node, closing selects the end of a group */
+static enum json_event event_type(const json *node, int closing)
+{
+    switch (node->type)
+    {
+        case JSON_OBJECT:
+            return closing ? JSON_EVENT_END_OBJECT : JSON_EVENT_START_OBJECT;
+        case JSON_ARRAY:
+            return closing ? JSON_EVENT_END_ARRAY : JSON_EVENT_START_ARRAY;
+        case JSON_STRING:
+            return JSON_EVENT_STRING;
+        case JSON_INTEGER:
+        case JSON_DOUBLE:
+            return JSON_EVENT_NUMBER;
+        case JSON_BOOLEAN:
+            return JSON_EVENT_BOOLEAN;
+        case JSON_NULL:
+            return JSON_EVENT_NULL;
+        default:
+            return JSON_EVENT_KEY;
+    }
+}
+
+/* Sends a node to the callback of an event parser, returns 0 to stop */
+static int emit(json_parser *parser, const json *node, int closing)
+{
+    if (parser->callback == NULL)
+    {
+        return 1;
+    }
+    if (parser->callback(event_type(node, closing), node, parser->data) > 0)
+    {
+        return 1;
+    }
+    parser->stopped = 1;
+    return 0;
+}
+
+/* Whether a scan() failure at str is due to the end of the current chunk */
+static int is_cut(const json_parser *parser, const char *str)
+{
+    /* Unterminated string or escape sequence */
+    return (str == parser->end)
+        || ((*str == '\\') && (parser->end - str < 6));
+}
+
+/* Saves the state of parse() until more text is available */
+static const char *suspend(json_parser *parser, json *node, const char *str)
+{
+    parser->node = node;
+    parser->resume = str;
+    return NULL;
+}
+
+/*
+ * Parse document - returns an error position or NULL on success
+ * A push parser also returns NULL when it needs more text to continue
+ */
+static const char *parse(json_parser *parser, json *node, const char *left)
+{
+    const char *right = NULL;
+    const char *token;
+
+    simd_classify(&parser->block, left, parser->end);
+    while (node != NULL)
+    {
+        const char *start = left;
+
+        if (!(token = scan(parser, &left, &right)))
+        {
+            if (parser->partial && is_cut(parser, left))
+            {
+                return suspend(parser, node, start);
+            }
+            return left;
+        }
+        /* The element could continue in the next chunk */
+        if (parser->partial && (token == parser->end))
+        {
+            return suspend(parser, node, start);
+        }
+        switch (at(parser, token))
+        {
+            case '{':
+            case '[':
+                /* Commas between groups are required: [[] []] */
+                if (node->type != JSON_UNDEFINED)
+                {
                     return left;
                 }
                 /* Contents before groups are not allowed: 1[] */
@@ -397,8 +1192,20 @@ static const char *parse(json *node, const char *left)
                 {
                     return token;
                 }
+                if (!add_node(parser) || !add_depth(parser))
+                {
+                    return token;
+                }
                 node->type = token_type(*token);
-                node = create_child(node);
+                if (!emit(parser, node, 0))
+                {
+                    return token;
+                }
+                if (use_shapes(parser) && !start_shape(parser, node))
+                {
+                    return token;
+                }
+                node = create_child(parser, node);
                 break;
             case ':':
                 if (left == token)
@@ -410,10 +1217,18 @@ static const char *parse(json *node, const char *left)
                 {
                     return token;
                 }
-                if (!set_name(node, left, right))
+                if (!set_name(parser, node, left, right))
+                {
+                    return left;
+                }
+                if (check_names(parser) && !unique_name(parser, node))
                 {
                     return left;
                 }
+                if (!emit(parser, node, 0))
+                {
+                    return token;
+                }
                 break;
             case ',':
                 if (node->parent == NULL)
@@ -430,7 +1245,12 @@ static const char *parse(json *node, const char *left)
                     {
                         return left;
                     }
-                    if (!set_value(node, left, right))
+                    if (!set_value(parser, node, left, right))
+                    {
+                        return left;
+                    }
+                    /* A rejected value is reported at its position */
+                    if (!emit(parser, node, 0))
                     {
                         return left;
                     }
@@ -442,7 +1262,11 @@ static const char *parse(json *node, const char *left)
                         return left;
                     }
                 }
-                node = create_next(node);
+                node = create_next(parser, drop_name(node));
+                if (use_shapes(parser))
+                {
+                    next_shape(parser);
+                }
                 break;
             case ']':
             case '}':
@@ -455,9 +1279,14 @@ static const char *parse(json *node, const char *left)
                     if (left == token)
                     {
                         /* Remove empty group: {} or [] */
-                        if ((node->prev == NULL) && (node->name == NULL))
+                        if (is_first(parser, node) && (node->name == NULL))
                         {
-                            node = delete_child(node->parent);
+                            parser->depth--;
+                            node = delete_child(parser, node->parent);
+                            if (!emit(parser, node, 1))
+                            {
+                                return token;
+                            }
                             break;
                         }
                         return left;
@@ -466,7 +1295,11 @@ static const char *parse(json *node, const char *left)
                     {
                         return left;
                     }
-                    if (!set_value(node, left, right))
+                    if (!set_value(parser, node, left, right))
+                    {
+                        return left;
+                    }
+                    if (!emit(parser, node, 0))
                     {
                         return left;
                     }
@@ -478,11 +1311,18 @@ static const char *parse(json *node, const char *left)
                         return left;
                     }
                 }
+                node = drop_name(node);
+                clear_names(parser, node->parent);
+                parser->depth--;
                 node = node->parent;
+                if (!emit(parser, node, 1))
+                {
+                    return token;
+                }
                 break;
             case '\0':
                 /* Bad closed document */
-                if (node->parent != NULL)
+                if ((node->parent != parser->top) || (token != parser->end))
                 {
                     return left;
                 }
@@ -492,7 +1332,11 @@ static const char *parse(json *node, const char *left)
                     {
                         return left;
                     }
-                    if (!set_value(node, left, right))
+                    if (!set_value(parser, node, left, right))
+                    {
+                        return left;
+                    }
+                    if (!emit(parser, node, 0))
                     {
                         return left;
                     }
@@ -513,126 +1357,881 @@ static const char *parse(json *node, const char *left)
     return left;
 }
 
-static void clear_error(json_error *error)
+void parser_clear_error(json_error *error)
 {
     if (error != NULL)
     {
-        error->line = error->column = 0;
+        error->offset = error->line = error->column = 0;
+        error->code = JSON_ERROR_NONE;
     }
 }
 
-static void set_error(const char *str, const char *end, json_error *error)
+/* Whitespace of json (isspace also accepts \f and \v) */
+int parser_is_space(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static enum json_error_code error_code(const json_parser *parser)
+{
+    return parser->limit ? parser->limit : JSON_ERROR_SYNTAX;
+}
+
+static void set_error(const json_parser *parser, const char *str,
+    const char *end, json_error *error)
 {
     if (error != NULL)
     {
-        error->line = error->column = 1;
-    }
-    else
-    {
-        return;
-    }
-    for (; str < end; str++)
-    {
-        if (*str == '\n')
-        {
-            error->line++;
-            error->column = 1;
-        }
-        else if (is_utf8(*str))
-        {
-            error->column++;
-        }
+        /* Line and column are computed on demand (json_error_locate) */
+        error->offset = (size_t)(end - str);
+        error->code = error_code(parser);
     }
 }
 
-json *json_parse(const char *str, json_error *error)
+/* Terminates and unescapes in place a name or a string (in-situ) */
+static void terminate_insitu(char *str)
 {
-    clear_error(error);
-    if (str == NULL)
+    int escaped = 0;
+    size_t length = quoted_length(str, &escaped);
+
+    str[length] = '\0';
+    if (escaped)
     {
-        return NULL;
+        *unescape(str, str, str + length) = '\0';
     }
+}
 
-    json *node = create_node();
+/* Names and strings of an in-situ tree, once the text is parsed */
+static void terminate_tree(json *node)
+{
+    json *root = node;
 
-    if (node != NULL)
+    while (node != NULL)
     {
-        const char *end = parse(node, str);
-
-        if (end != NULL)
+        if (node->name != NULL)
         {
-            set_error(str, end, error);
-            json_free(node);
-            return NULL;
+            terminate_insitu(node->name);
+        }
+        if (node->type == JSON_STRING)
+        {
+            terminate_insitu(node->value.string);
+        }
+        if (node->child != NULL)
+        {
+            node = node->child;
+            continue;
+        }
+        while ((node != root) && (node->next == NULL))
+        {
+            node = node->parent;
         }
+        node = node != root ? node->next : NULL;
     }
-    return node;
 }
 
-static char *read_file(FILE *file, size_t size)
+/* Parses the text from str to parser->end into node, returns 0 on error */
+static int parse_tree(json_parser *parser, json *node, const char *str,
+    json_error *error)
 {
-    char *str = malloc(size + 1);
+    const char *end = parse(parser, node, str);
 
-    if (str != NULL)
+    free_names(parser);
+    free_shapes(parser);
+    if (end != NULL)
     {
-        if (fread(str, 1, size, file) == size)
-        {
-            str[size] = '\0';
-        }
-        else
-        {
-            free(str);
-            str = NULL;
-        }
+        set_error(parser, str, end, error);
+        return 0;
     }
-    return str;
+    if (parser->insitu)
+    {
+        terminate_tree(node);
+    }
+    return 1;
 }
 
-static char *read_file_from(const char *path)
+/* Parses the text from str to parser->end */
+static json *parse_text(json_parser *parser, const char *str,
+    const json_options *options, json_error *error)
 {
-    FILE *file = fopen(path, "rb");
+    size_t length = (size_t)(parser->end - str);
 
-    if (file == NULL)
+    if (options != NULL)
+    {
+        parser->options = *options;
+    }
+    /* Fail before allocating anything */
+    if (exceeds(parser, parser->options.max_bytes, length, JSON_ERROR_BYTES))
     {
+        set_error(parser, str, str + parser->options.max_bytes, error);
         return NULL;
     }
 
-    char *str = NULL;
+    /* The whole text is validated at once, the parse stops at the error */
+    const char *end = parser->end;
 
-    if (fseek(file, 0L, SEEK_END) != -1)
+    if (parser->options.flags & JSON_PARSE_UTF8)
     {
-        long size = ftell(file);
-
-        if ((size != -1) && (fseek(file, 0L, SEEK_SET) != -1))
-        {
-            str = read_file(file, (size_t)size);
-        }
+        parser->end = utf8_validate(str, end);
     }
-    fclose(file);
-    return str;
-}
 
-json *json_parse_file(const char *path, json_error *error)
-{
-    char *str = read_file_from(path);
-    json *node = json_parse(str, error);
+    json *node = create_node(parser, length, options ? options->flags : 0);
 
-    free(str);
+    if ((node != NULL) && !parse_tree(parser, node, str, error))
+    {
+        json_free(node);
+        return NULL;
+    }
+    if ((node != NULL) && (parser->end != end))
+    {
+        set_error(parser, str, parser->end, error);
+        json_free(node);
+        return NULL;
+    }
     return node;
 }
 
-void json_print_error(const char *path, const json_error *error)
+/* End of a text, not looked for past the limit of bytes */
+static const char *text_end(const char *str, const json_options *options)
 {
-    if ((error == NULL) || (error->line == 0))
+    size_t max = options ? options->max_bytes : 0;
+
+    if (max > 0)
     {
-        fprintf(stderr, "json: %s\n%s\n",
+        const char *end = memchr(str, '\0', max + 1);
+
+        return end ? end : str + max + 1;
+    }
+    return str + strlen(str);
+}
+
+json *json_parse_options(const char *str, const json_options *options,
+    json_error *error)
+{
+    parser_clear_error(error);
+    if (str == NULL)
+    {
+        return NULL;
+    }
+
+    json_parser parser = {.end = text_end(str, options)};
+
+    return parse_text(&parser, str, options, error);
+}
+
+json *parser_parse(const char *str, const char *end,
+    const json_options *options, json_error *error)
+{
+    parser_clear_error(error);
+
+    json_parser parser = {.end = end};
+
+    return parse_text(&parser, str, options, error);
+}
+
+/*
+ * Parses in place the text from str to end into the document of the last
+ * call when possible (*arena is NULL the first time), returns its root
+ */
+json *parser_reuse(json_arena **arena, char *str, const char *end,
+    json_error *error)
+{
+    parser_clear_error(error);
+
+    json_arena *document = *arena;
+
+    if ((document != NULL) && document->dirty)
+    {
+        json_free(&document->root);
+        document = NULL;
+    }
+    if (document != NULL)
+    {
+        arena_reset(document);
+    }
+    else
+    {
+        document = arena_create((size_t)(end - str) * 2);
+        if (document == NULL)
+        {
+            *arena = NULL;
+            return NULL;
+        }
+    }
+    *arena = document;
+
+    json_parser parser = {.arena = document, .end = end, .insitu = 1};
+
+    if (!parse_tree(&parser, &document->root, str, error))
+    {
+        return NULL;
+    }
+    return &document->root;
+}
+
+json *json_parse(const char *str, json_error *error)
+{
+    return json_parse_options(str, NULL, error);
+}
+
+json *json_parse_insitu(char *str, const json_options *options,
+    json_error *error)
+{
+    parser_clear_error(error);
+    if (str == NULL)
+    {
+        return NULL;
+    }
+
+    json_parser parser = {.end = text_end(str, options), .insitu = 1};
+
+    return parse_text(&parser, str, options, error);
+}
+
+/* Names and strings are copied from the mapped file, it is not kept */
+json *json_parse_file_options(const char *path, const json_options *options,
+    json_error *error)
+{
+    parser_clear_error(error);
+
+    json_file file;
+
+    if (!file_load(&file, path))
+    {
+        if (error != NULL)
+        {
+            error->code = JSON_ERROR_READ;
+        }
+        return NULL;
+    }
+
+    json_parser parser = {.end = file.text + file.size};
+    json *node = parse_text(&parser, file.text, options, error);
+
+    file_release(&file);
+    return node;
+}
+
+json *json_parse_file(const char *path, json_error *error)
+{
+    return json_parse_file_options(path, NULL, error);
+}
+
+/*
+ * Parses the elements of a group from str to end (brackets excluded) as
+ * children of a new node of the given type, returns the node or NULL on
+ * fail, the number of nodes parsed is stored in nodes
+ */
+json *parser_slice(enum json_type type, const char *str, const char *end,
+    const json_options *options, size_t *nodes)
+{
+    json_parser parser = {.end = end, .options = *options, .depth = 1};
+
+    if ((options->flags & JSON_PARSE_UTF8) && (utf8_validate(str, end) != end))
+    {
+        return NULL;
+    }
+
+    json *top = create_node(&parser, (size_t)(end - str), options->flags);
+
+    if (top == NULL)
+    {
+        return NULL;
+    }
+    top->type = type;
+    parser.top = top;
+
+    json *child = NULL;
+
+    if (!use_shapes(&parser) || start_shape(&parser, top))
+    {
+        child = create_child(&parser, top);
+    }
+    if ((child == NULL) || !parse_tree(&parser, child, str, NULL))
+    {
+        free_shapes(&parser);
+        json_free(top);
+        return NULL;
+    }
+    *nodes = parser.nodes;
+    return top;
+}
+
+/* Event parser */
+
+/* The position where the callback stopped is also reported */
+int parser_events(const char *str, const char *end,
+    json_event_callback callback, void *data, json_error *error)
+{
+    parser_clear_error(error);
+
+    json_parser parser =
+    {
+        .end = end,
+        .callback = callback,
+        .data = data
+    };
+    json *node = new_node(&parser);
+
+    if (node == NULL)
+    {
+        return -1;
+    }
+
+    const char *stop = parse(&parser, node, str);
+    int result = 1;
+
+    if (stop != NULL)
+    {
+        set_error(&parser, str, stop, error);
+        result = parser.stopped ? 0 : -1;
+    }
+    /* One node per level */
+    while (node != NULL)
+    {
+        json *child = node->child;
+
+        free(((json_level *)(void *)node)->name);
+        free(node);
+        node = child;
+    }
+    free(parser.scratch);
+    return result;
+}
+
+int json_parse_events(const char *str, json_event_callback callback,
+    void *data, json_error *error)
+{
+    if ((str == NULL) || (callback == NULL))
+    {
+        parser_clear_error(error);
+        return -1;
+    }
+
+    int result = parser_events(str, str + strlen(str), callback, data, error);
+
+    if (result == 0)
+    {
+        parser_clear_error(error);
+    }
+    return result;
+}
+
+/* Validator */
+
+/*
+ * Checks the grammar of a text as the parser does, without building a
+ * tree, names and strings are not copied and no memory is allocated
+ * unless the text is nested deeper than VALID_LEVELS, returns 1 when the
+ * text is a valid json document, 0 otherwise
+ */
+int json_valid(const char *str, size_t length, json_error *error)
+{
+    parser_clear_error(error);
+    if (str == NULL)
+    {
+        return 0;
+    }
+
+    json_level levels[VALID_LEVELS];
+    json_parser parser =
+    {
+        .end = str + length,
+        .validate = 1,
+        .levels = levels,
+        .levels_size = VALID_LEVELS
+    };
+    json *node = new_node(&parser);
+    const char *stop = parse(&parser, node, str);
+
+    if (stop != NULL)
+    {
+        set_error(&parser, str, stop, error);
+    }
+    /* Nodes of the levels out of the pool */
+    for (size_t depth = 0; node != NULL; depth++)
+    {
+        json *child = node->child;
+
+        if (depth >= VALID_LEVELS)
+        {
+            free(node);
+        }
+        node = child;
+    }
+    return stop == NULL;
+}
+
+/* Push parser */
+
+json_parser *json_parser_create(const json_options *options)
+{
+    json_parser *parser = calloc(1, sizeof *parser);
+
+    if (parser == NULL)
+    {
+        return NULL;
+    }
+    /* The size of the document is unknown, the arena grows on demand */
+    parser->root = create_node(parser, 0, options ? options->flags : 0);
+    if (parser->root == NULL)
+    {
+        free(parser);
+        return NULL;
+    }
+    if (options != NULL)
+    {
+        parser->options = *options;
+    }
+    parser->node = parser->root;
+    parser->partial = 1;
+    parser->utf8 = (parser->options.flags & JSON_PARSE_UTF8) != 0;
+    return parser;
+}
+
+/* Parses the text from str to end, returns 0 on error */
+static int push(json_parser *parser, const char *str, const char *end)
+{
+    parser->end = end;
+    parser->resume = NULL;
+
+    const char *error = parse(parser, parser->node, str);
+
+    if (error != NULL)
+    {
+        parser->error.offset = parser->offset + (size_t)(error - str);
+        parser->error.code = error_code(parser);
+        parser->node = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+/* Appends text from outside the carry buffer, returns 0 on error */
+static int carry_append(json_parser *parser, const char *str, size_t length)
+{
+    size_t size = parser->carry_length + length;
+
+    if (length == 0)
+    {
+        return 1;
+    }
+    if (size > parser->carry_size)
+    {
+        size_t next = parser->carry_size ? parser->carry_size : 64;
+
+        while (next < size)
+        {
+            next *= 2;
+        }
+
+        char *carry = realloc(parser->carry, next);
+
+        if (carry == NULL)
+        {
+            /* Stop parsing */
+            parser->node = NULL;
+            return 0;
+        }
+        parser->carry = carry;
+        parser->carry_size = next;
+    }
+    memcpy(parser->carry + parser->carry_length, str, length);
+    parser->carry_length = size;
+    return 1;
+}
+
+/* Drops the contents of the carry buffer before str */
+static void carry_drop(json_parser *parser, const char *str)
+{
+    size_t length = (size_t)(parser->carry + parser->carry_length - str);
+
+    parser->offset += (size_t)(str - parser->carry);
+    memmove(parser->carry, str, length);
+    parser->carry_length = length;
+}
+
+int json_parser_feed(json_parser *parser, const char *str, size_t length)
+{
+    if ((parser == NULL) || (parser->node == NULL) || (str == NULL))
+    {
+        return 0;
+    }
+
+    size_t max = parser->options.max_bytes;
+
+    if (exceeds(parser, max, parser->bytes + length, JSON_ERROR_BYTES))
+    {
+        /* Position of the first byte past the limit */
+        parser->error.offset = max;
+        parser->error.code = JSON_ERROR_BYTES;
+        parser->node = NULL;
+        return 0;
+    }
+    parser->bytes += length;
+
+    const char *end = str + length;
+
+    /*
+     * Complete the element left by the previous chunk, adding text from
+     * this one in growing steps, until parse() resumes past the carry
+     */
+    while ((parser->carry_length > 0) && (str < end))
+    {
+        size_t carried = parser->carry_length;
+        size_t size = (size_t)(end - str);
+
+        /* Wait until the carry doubles to keep small chunks linear */
+        if (carried + size < parser->carry_retry)
+        {
+            return carry_append(parser, str, size);
+        }
+        if (size > carried)
+        {
+            size = carried < 64 ? 64 : carried;
+            size = size < (size_t)(end - str) ? size : (size_t)(end - str);
+        }
+        if (!carry_append(parser, str, size))
+        {
+            return 0;
+        }
+        if (!push(parser, parser->carry, parser->carry + parser->carry_length))
+        {
+            return 0;
+        }
+        if (parser->resume >= parser->carry + carried)
+        {
+            /* Go on from the same point of this chunk */
+            str += parser->resume - (parser->carry + carried);
+            parser->offset += (size_t)(parser->resume - parser->carry);
+            parser->carry_length = parser->carry_retry = 0;
+            break;
+        }
+        carry_drop(parser, parser->resume);
+        parser->carry_retry = parser->carry_length * 2;
+        str += size;
+    }
+    if ((parser->carry_length == 0) && (str < end))
+    {
+        if (!push(parser, str, end))
+        {
+            return 0;
+        }
+        parser->offset += (size_t)(parser->resume - str);
+        str = parser->resume;
+        return carry_append(parser, str, (size_t)(end - str));
+    }
+    return 1;
+}
+
+json *json_parser_finish(json_parser *parser, json_error *error)
+{
+    parser_clear_error(error);
+    if ((parser == NULL) || (parser->root == NULL))
+    {
+        return NULL;
+    }
+    if (parser->node != NULL)
+    {
+        const char *str = parser->carry ? parser->carry : "";
+
+        parser->partial = 0;
+        push(parser, str, str + parser->carry_length);
+    }
+    if (parser->node == NULL)
+    {
+        if (error != NULL)
+        {
+            *error = parser->error;
+        }
+        return NULL;
+    }
+
+    json *root = parser->root;
+
+    parser->root = parser->node = NULL;
+    return root;
+}
+
+void json_parser_destroy(json_parser *parser)
+{
+    if (parser != NULL)
+    {
+        json_free(parser->root);
+        free(parser->carry);
+        free_names(parser);
+        free_shapes(parser);
+        free(parser);
+    }
+}
+
+/* Window of a stream read by parts (line and element readers) */
+
+#define PARSER_WINDOW_SIZE 65536
+
+int parser_fill(parser_window *window, parser_input input, void *data)
+{
+    size_t length = window->length - window->head;
+
+    if (window->head > 0)
+    {
+        memmove(window->text, window->text + window->head, length);
+        window->offset += window->head;
+        window->head = 0;
+        window->length = length;
+    }
+    /* The window grows only when the pending text doesn't fit */
+    if (length == window->size)
+    {
+        size_t size = window->size ? window->size * 2 : PARSER_WINDOW_SIZE;
+        char *text = realloc(window->text, size);
+
+        if (text == NULL)
+        {
+            return -1;
+        }
+        window->text = text;
+        window->size = size;
+    }
+
+    size_t bytes;
+
+    if (!input(data, window->text + length, window->size - length, &bytes))
+    {
+        return -1;
+    }
+    window->length += bytes;
+    window->eof = bytes < window->size - length;
+    return bytes > 0;
+}
+
+/* Line-delimited reader (NDJSON / JSON Lines) */
+
+struct json_lines
+{
+    FILE *file;
+    /* Document recycled from one record to the next */
+    json_arena *arena;
+    /* Text read from the file */
+    parser_window window;
+    /* Lines and records (non blank lines) read so far */
+    size_t line, record;
+};
+
+json_lines *json_lines_open(FILE *file)
+{
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    json_lines *lines = calloc(1, sizeof *lines);
+
+    if (lines != NULL)
+    {
+        lines->file = file;
+    }
+    return lines;
+}
+
+static int lines_input(void *data, char *buf, size_t size, size_t *bytes)
+{
+    FILE *file = data;
+
+    *bytes = fread(buf, 1, size, file);
+    return (*bytes > 0) || !ferror(file);
+}
+
+/* Whether a line holds nothing but spaces (not a record) */
+int parser_is_blank(const char *str, const char *end)
+{
+    for (; str < end; str++)
+    {
+        if ((*str != ' ') && (*str != '\t') && (*str != '\r'))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static json *lines_parse(json_lines *lines, char *str, const char *end,
+    json_error *error)
+{
+    json *node = parser_reuse(&lines->arena, str, end, error);
+
+    if ((node == NULL) && (error != NULL) &&
+        (error->code != JSON_ERROR_NONE))
+    {
+        const parser_window *window = &lines->window;
+
+        /* The column is located within the record */
+        json_error_locate(error, str);
+        error->line = lines->line;
+        error->offset += window->offset + (size_t)(str - window->text);
+    }
+    return node;
+}
+
+/* The text could not be read (or the buffer could not grow) */
+static json *lines_fail(const json_lines *lines, json_error *error)
+{
+    if (error != NULL)
+    {
+        error->offset = lines->window.offset + lines->window.length;
+        error->code = JSON_ERROR_READ;
+    }
+    return NULL;
+}
+
+/*
+ * Returns the tree of the next record, owned by the reader until the next
+ * call, NULL on a malformed record (error->code > 0), on a read error
+ * (JSON_ERROR_READ) or at the end (JSON_ERROR_NONE)
+ */
+json *json_lines_read(json_lines *lines, json_error *error)
+{
+    parser_clear_error(error);
+    if (lines == NULL)
+    {
+        return NULL;
+    }
+
+    parser_window *window = &lines->window;
+
+    while (1)
+    {
+        char *str = window->text + window->head;
+        size_t length = window->length - window->head;
+        char *end = length ? memchr(str, '\n', length) : NULL;
+
+        if (end == NULL)
+        {
+            int rc = parser_fill(window, lines_input, lines->file);
+
+            if (rc > 0)
+            {
+                continue;
+            }
+            if (rc < 0)
+            {
+                return lines_fail(lines, error);
+            }
+            if (window->head == window->length)
+            {
+                return NULL;
+            }
+            /* Last line without a line break */
+            str = window->text;
+            end = str + window->length;
+        }
+        window->head = (size_t)(end - window->text);
+        if (window->head < window->length)
+        {
+            window->head++;
+        }
+        lines->line++;
+        if (!parser_is_blank(str, end))
+        {
+            lines->record++;
+            return lines_parse(lines, str, end, error);
+        }
+    }
+}
+
+/* Number of the last record read (blank lines are not records) */
+size_t json_lines_record(const json_lines *lines)
+{
+    return lines ? lines->record : 0;
+}
+
+/* The file is not closed */
+void json_lines_close(json_lines *lines)
+{
+    if (lines != NULL)
+    {
+        if (lines->arena != NULL)
+        {
+            json_free(&lines->arena->root);
+        }
+        free(lines->window.text);
+        free(lines);
+    }
+}
+
+/*
+ * Computes line and column of an error from the parsed text, only the
+ * bytes before the error are scanned (the text doesn't need a NUL)
+ */
+void json_error_locate(json_error *error, const char *text)
+{
+    if ((error == NULL) || (text == NULL) ||
+        (error->code == JSON_ERROR_NONE))
+    {
+        return;
+    }
+
+    const char *str = text, *end = text + error->offset, *next;
+
+    error->line = 1;
+    while ((next = memchr(str, '\n', (size_t)(end - str))) != NULL)
+    {
+        error->line++;
+        str = next + 1;
+    }
+    error->column = utf8_length(str, (size_t)(end - str)) + 1;
+}
+
+/* Locates an error of a file not located yet, returns 0 on fail */
+static int locate_file(const char *path, json_error *error)
+{
+    json_file file;
+
+    if ((path == NULL) || !file_load(&file, path))
+    {
+        return 0;
+    }
+    if (error->offset <= file.size)
+    {
+        json_error_locate(error, file.text);
+    }
+    file_release(&file);
+    return error->line > 0;
+}
+
+void json_print_error(const char *path, const json_error *error)
+{
+    if ((error == NULL) || (error->code == JSON_ERROR_NONE) ||
+        (error->code == JSON_ERROR_READ))
+    {
+        fprintf(stderr, "json: %s\n%s\n",
             path ? path : "", strerror(errno)
         );
+        return;
+    }
+
+    static const char *messages[] =
+    {
+        [JSON_ERROR_SYNTAX] = "Error",
+        [JSON_ERROR_DEPTH] = "Limit of depth exceeded",
+        [JSON_ERROR_NODES] = "Limit of nodes exceeded",
+        [JSON_ERROR_STRING] = "Limit of string length exceeded",
+        [JSON_ERROR_BYTES] = "Limit of bytes exceeded",
+        [JSON_ERROR_TYPE] = "Unexpected type",
+        [JSON_ERROR_DUPLICATE] = "Duplicated name",
+    };
+    json_error position = *error;
+
+    if ((position.line > 0) || locate_file(path, &position))
+    {
+        fprintf(stderr, "json: %s\n%s at line %zu, column %zu\n",
+            path ? path : "", messages[error->code],
+            position.line, position.column
+        );
     }
     else
     {
-        fprintf(stderr, "json: %s\nError at line %d, column %d\n",
-            path ? path : "", error->line, error->column
+        fprintf(stderr, "json: %s\n%s at offset %zu\n",
+            path ? path : "", messages[error->code], position.offset
         );
     }
 }
@@ -6,8 +6,10 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <string.h>
-#include "json_struct.h"
+#include "json_arena.h"
+#include "json_number.h"
 
 static const char *type_name[] =
 {
@@ -177,13 +179,32 @@ const char *json_string(const json *node)
     return node->value.string;
 }
 
+/* Numbers kept as text (JSON_PARSE_LAZY) are converted when read */
+static double to_number(const json *node)
+{
+    if (node->flags & JSON_NUMBER_TEXT)
+    {
+        const char *str = node->value.string;
+        json temp = {0};
+
+        number_parse(&temp, str, str + strlen(str));
+        return temp.value.number;
+    }
+    return node->value.number;
+}
+
 long long json_integer(const json *node)
 {
     if ((node == NULL) || (node->type == JSON_STRING))
     {
         return 0;
     }
-    return (long long)node->value.number;
+    if (node->type == JSON_INTEGER)
+    {
+        /* Saturate unsigned values out of range */
+        return node->flags & JSON_UNSIGNED ? LLONG_MAX : node->value.integer;
+    }
+    return (long long)to_number(node);
 }
 
 unsigned long long json_real(const json *node)
@@ -192,7 +213,23 @@ unsigned long long json_real(const json *node)
     {
         return 0;
     }
-    return (unsigned long long)node->value.number;
+    if (node->type == JSON_INTEGER)
+    {
+        return node->value.real;
+    }
+    return (unsigned long long)to_number(node);
+}
+
+/* Returns the value of a scalar (but string) as double */
+static double to_double(const json *node)
+{
+    if (node->type == JSON_INTEGER)
+    {
+        return node->flags & JSON_UNSIGNED
+            ? (double)node->value.real
+            : (double)node->value.integer;
+    }
+    return to_number(node);
 }
 
 double json_double(const json *node)
@@ -201,7 +238,7 @@ double json_double(const json *node)
     {
         return 0.0;
     }
-    return node->value.number;
+    return to_double(node);
 }
 
 double json_number(const json *node)
@@ -210,7 +247,7 @@ double json_number(const json *node)
     {
         return 0.0;
     }
-    return node->value.number;
+    return to_double(node);
 }
 
 int json_boolean(const json *node)
@@ -219,7 +256,11 @@ int json_boolean(const json *node)
     {
         return 0;
     }
-    return node->value.number != 0;
+    if (node->type == JSON_INTEGER)
+    {
+        return node->value.integer != 0;
+    }
+    return to_number(node) != 0;
 }
 
 int json_is_any(const json *node)
@@ -267,7 +308,7 @@ int json_is_real(const json *node)
 {
     return (node != NULL)
         && (node->type == JSON_INTEGER)
-        && (node->value.number >= 0);
+        && ((node->flags & JSON_UNSIGNED) || (node->value.integer >= 0));
 }
 
 int json_is_double(const json *node)
@@ -427,9 +468,26 @@ json *json_find(const json *root, const char *name)
     {
         return NULL;
     }
+
+    /* Interned names are compared by address */
+    const char *interned = NULL;
+    int lookup = 1;
+
     for (json *node = root->child; node != NULL; node = node->next)
     {
-        if (strcmp(node->name, name) == 0)
+        if (node->flags & JSON_INTERNED_NAME)
+        {
+            if (lookup)
+            {
+                interned = arena_interned(root, name);
+                lookup = 0;
+            }
+            if (node->name == interned)
+            {
+                return node;
+            }
+        }
+        else if (strcmp(node->name, name) == 0)
         {
             return node;
         }
@@ -521,7 +579,7 @@ static int equal(const json *a, const json *b, int depth)
         {
             return 0;
         }
-        if ((a->name != NULL) && strcmp(a->name, b->name))
+        if ((a->name != b->name) && strcmp(a->name, b->name))
         {
             return 0;
         }
@@ -530,9 +588,14 @@ static int equal(const json *a, const json *b, int depth)
     {
         return strcmp(a->value.string, b->value.string) == 0;
     }
+    else if (a->type == JSON_INTEGER)
+    {
+        return (a->value.integer == b->value.integer)
+            && !((a->flags ^ b->flags) & JSON_UNSIGNED);
+    }
     else
     {
-        return a->value.number == b->value.number;
+        return to_number(a) == to_number(b);
     }
     return 1;
 }
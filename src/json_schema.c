@@ -11,6 +11,7 @@
 #include "json_macros.h"
 #include "json_format.h"
 #include "json_schema.h"
+#include "json_utf8.h"
 
 typedef struct
 {
@@ -460,17 +461,7 @@ static int test_unique_items(const json *node, const json *rule)
 
 static size_t get_length(const char *str)
 {
-    size_t length = 0;
-
-    while (*str != '\0')
-    {
-        if (is_utf8(*str))
-        {
-            length++;
-        }
-        str++;
-    }
-    return length;
+    return utf8_length(str, strlen(str));
 }
 
 static int test_min_length(const json *node, const json *rule)
@@ -545,6 +536,36 @@ static int test_pattern(const json *node, const json *rule)
     return 1;
 }
 
+/* Compares two numbers, integers are compared exactly */
+static int compare_numbers(const json *a, const json *b)
+{
+    if (json_is_integer(a) && json_is_integer(b))
+    {
+        int a_real = json_is_real(a), b_real = json_is_real(b);
+
+        if (a_real != b_real)
+        {
+            return a_real ? 1 : -1;
+        }
+        if (a_real)
+        {
+            unsigned long long x = json_real(a), y = json_real(b);
+
+            return (x > y) - (x < y);
+        }
+        else
+        {
+            long long x = json_integer(a), y = json_integer(b);
+
+            return (x > y) - (x < y);
+        }
+    }
+
+    double x = json_number(a), y = json_number(b);
+
+    return (x > y) - (x < y);
+}
+
 static int test_minimum(const json *node, const json *rule)
 {
     if (!json_is_number(rule))
@@ -555,11 +576,11 @@ static int test_minimum(const json *node, const json *rule)
     {
         if (json_is_true(json_find(json_parent(rule), "exclusiveMinimum")))
         {
-            return json_number(node) > json_number(rule);
+            return compare_numbers(node, rule) > 0;
         }
         else
         {
-            return json_number(node) >= json_number(rule);
+            return compare_numbers(node, rule) >= 0;
         }
     }
     return 1;
@@ -575,11 +596,11 @@ static int test_maximum(const json *node, const json *rule)
     {
         if (json_is_true(json_find(json_parent(rule), "exclusiveMaximum")))
         {
-            return json_number(node) < json_number(rule);
+            return compare_numbers(node, rule) < 0;
         }
         else
         {
-            return json_number(node) <= json_number(rule);
+            return compare_numbers(node, rule) <= 0;
         }
     }
     return 1;
@@ -591,6 +612,15 @@ static int test_multiple_of(const json *node, const json *rule)
     {
         return SCHEMA_ERROR;
     }
+    if (json_is_integer(node) && json_is_real(rule))
+    {
+        /* Exact for integers, using the magnitude of the node */
+        unsigned long long value = json_is_real(node)
+            ? json_real(node)
+            : 0 - json_real(node);
+
+        return value % json_real(rule) == 0;
+    }
     if (json_is_number(node))
     {
         return fmod(json_number(node), json_number(rule)) == 0;
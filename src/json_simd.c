@@ -0,0 +1,291 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#include <string.h>
+#include "json_simd.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+
+#define eq(a, b) _mm256_cmpeq_epi8((a), _mm256_set1_epi8(b))
+#define join(a, b) _mm256_or_si256((a), (b))
+
+static void classify(const char *str, uint64_t *space, uint64_t *delim)
+{
+    *space = *delim = 0;
+    for (unsigned shift = 0; shift < SIMD_BLOCK_SIZE; shift += 32)
+    {
+        __m256i chr = _mm256_loadu_si256((const __m256i *)(const void *)str);
+        /* '[' and '{' differ in bit 5 only, the same for ']' and '}' */
+        __m256i low = join(chr, _mm256_set1_epi8(0x20));
+        __m256i ws = join(join(eq(chr, ' '), eq(chr, '\t')),
+                          join(eq(chr, '\n'), eq(chr, '\r')));
+        __m256i tk = join(join(join(eq(low, '{'), eq(low, '}')),
+                               join(eq(chr, ':'), eq(chr, ','))),
+                          join(eq(chr, '"'), eq(chr, '\0')));
+
+        *space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << shift;
+        *delim |= (uint64_t)(uint32_t)_mm256_movemask_epi8(join(ws, tk)) << shift;
+        str += 32;
+    }
+}
+
+#define bits(v) (uint64_t)(uint32_t)_mm256_movemask_epi8(v)
+
+static void mark(const char *str, json_marks *marks)
+{
+    memset(marks, 0, sizeof *marks);
+    for (unsigned shift = 0; shift < SIMD_BLOCK_SIZE; shift += 32)
+    {
+        __m256i chr = _mm256_loadu_si256((const __m256i *)(const void *)str);
+        __m256i low = join(chr, _mm256_set1_epi8(0x20));
+
+        marks->quote |= bits(eq(chr, '"')) << shift;
+        marks->escape |= bits(eq(chr, '\\')) << shift;
+        marks->open |= bits(eq(low, '{')) << shift;
+        marks->close |= bits(eq(low, '}')) << shift;
+        marks->comma |= bits(eq(chr, ',')) << shift;
+        str += 32;
+    }
+}
+
+#define SIMD_WIDTH 32
+
+static unsigned special(const char *str)
+{
+    __m256i chr = _mm256_loadu_si256((const __m256i *)(const void *)str);
+    /* Unsigned chr <= 0x1f */
+    __m256i ctl = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(chr, _mm256_set1_epi8(0x1f)), chr
+    );
+    __m256i any = join(join(ctl, eq(chr, 0x7f)),
+                       join(eq(chr, '"'), eq(chr, '\\')));
+
+    return (uint32_t)_mm256_movemask_epi8(any);
+}
+
+static unsigned group(const char *str)
+{
+    __m256i chr = _mm256_loadu_si256((const __m256i *)(const void *)str);
+    __m256i low = join(chr, _mm256_set1_epi8(0x20));
+    __m256i any = join(join(eq(low, '{'), eq(low, '}')), eq(chr, '"'));
+
+    return (uint32_t)_mm256_movemask_epi8(any);
+}
+
+#elif defined(__SSE2__)
+
+#define eq(a, b) _mm_cmpeq_epi8((a), _mm_set1_epi8(b))
+#define join(a, b) _mm_or_si128((a), (b))
+
+static void classify(const char *str, uint64_t *space, uint64_t *delim)
+{
+    *space = *delim = 0;
+    for (unsigned shift = 0; shift < SIMD_BLOCK_SIZE; shift += 16)
+    {
+        __m128i chr = _mm_loadu_si128((const __m128i *)(const void *)str);
+        /* '[' and '{' differ in bit 5 only, the same for ']' and '}' */
+        __m128i low = join(chr, _mm_set1_epi8(0x20));
+        __m128i ws = join(join(eq(chr, ' '), eq(chr, '\t')),
+                          join(eq(chr, '\n'), eq(chr, '\r')));
+        __m128i tk = join(join(join(eq(low, '{'), eq(low, '}')),
+                               join(eq(chr, ':'), eq(chr, ','))),
+                          join(eq(chr, '"'), eq(chr, '\0')));
+
+        *space |= (uint64_t)(unsigned)_mm_movemask_epi8(ws) << shift;
+        *delim |= (uint64_t)(unsigned)_mm_movemask_epi8(join(ws, tk)) << shift;
+        str += 16;
+    }
+}
+
+#define bits(v) (uint64_t)(unsigned)_mm_movemask_epi8(v)
+
+static void mark(const char *str, json_marks *marks)
+{
+    memset(marks, 0, sizeof *marks);
+    for (unsigned shift = 0; shift < SIMD_BLOCK_SIZE; shift += 16)
+    {
+        __m128i chr = _mm_loadu_si128((const __m128i *)(const void *)str);
+        __m128i low = join(chr, _mm_set1_epi8(0x20));
+
+        marks->quote |= bits(eq(chr, '"')) << shift;
+        marks->escape |= bits(eq(chr, '\\')) << shift;
+        marks->open |= bits(eq(low, '{')) << shift;
+        marks->close |= bits(eq(low, '}')) << shift;
+        marks->comma |= bits(eq(chr, ',')) << shift;
+        str += 16;
+    }
+}
+
+#define SIMD_WIDTH 16
+
+static unsigned special(const char *str)
+{
+    __m128i chr = _mm_loadu_si128((const __m128i *)(const void *)str);
+    /* Unsigned chr <= 0x1f */
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(chr, _mm_set1_epi8(0x1f)), chr);
+    __m128i any = join(join(ctl, eq(chr, 0x7f)),
+                       join(eq(chr, '"'), eq(chr, '\\')));
+
+    return (unsigned)_mm_movemask_epi8(any);
+}
+
+static unsigned group(const char *str)
+{
+    __m128i chr = _mm_loadu_si128((const __m128i *)(const void *)str);
+    __m128i low = join(chr, _mm_set1_epi8(0x20));
+    __m128i any = join(join(eq(low, '{'), eq(low, '}')), eq(chr, '"'));
+
+    return (unsigned)_mm_movemask_epi8(any);
+}
+
+#else
+
+enum {SPACE = 1, DELIM = 2};
+
+static const unsigned char classes[256] =
+{
+    ['\0'] = DELIM,
+    ['\t'] = SPACE | DELIM, ['\n'] = SPACE | DELIM, ['\r'] = SPACE | DELIM,
+    [' '] = SPACE | DELIM,
+    ['"'] = DELIM, [','] = DELIM, [':'] = DELIM,
+    ['['] = DELIM, [']'] = DELIM, ['{'] = DELIM, ['}'] = DELIM,
+};
+
+static void classify(const char *str, uint64_t *space, uint64_t *delim)
+{
+    *space = *delim = 0;
+    for (unsigned bit = 0; bit < SIMD_BLOCK_SIZE; bit++)
+    {
+        unsigned class = classes[(unsigned char)str[bit]];
+
+        *space |= (uint64_t)(class & SPACE) << bit;
+        *delim |= (uint64_t)((class & DELIM) >> 1) << bit;
+    }
+}
+
+static void mark(const char *str, json_marks *marks)
+{
+    memset(marks, 0, sizeof *marks);
+    for (unsigned bit = 0; bit < SIMD_BLOCK_SIZE; bit++)
+    {
+        uint64_t mask = (uint64_t)1 << bit;
+
+        switch (str[bit])
+        {
+            case '"':
+                marks->quote |= mask;
+                break;
+            case '\\':
+                marks->escape |= mask;
+                break;
+            case '{':
+            case '[':
+                marks->open |= mask;
+                break;
+            case '}':
+            case ']':
+                marks->close |= mask;
+                break;
+            case ',':
+                marks->comma |= mask;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+#endif
+
+void simd_classify(json_block *block, const char *str, const char *end)
+{
+    block->base = str;
+    if (end - str >= SIMD_BLOCK_SIZE)
+    {
+        classify(str, &block->space, &block->delim);
+    }
+    else
+    {
+        /* Don't read past the end, pad with '\0' */
+        char tail[SIMD_BLOCK_SIZE] = {0};
+
+        memcpy(tail, str, (size_t)(end - str));
+        classify(tail, &block->space, &block->delim);
+    }
+}
+
+void simd_mark(json_marks *marks, const char *str, const char *end)
+{
+    if (end - str >= SIMD_BLOCK_SIZE)
+    {
+        mark(str, marks);
+    }
+    else
+    {
+        char tail[SIMD_BLOCK_SIZE] = {0};
+
+        memcpy(tail, str, (size_t)(end - str));
+        mark(tail, marks);
+    }
+}
+
+static int is_special(unsigned char c)
+{
+    return (c < 0x20) || (c == 0x7f) || (c == '"') || (c == '\\');
+}
+
+const char *simd_find_special(const char *str, const char *end)
+{
+#if defined(SIMD_WIDTH)
+    while (end - str >= SIMD_WIDTH)
+    {
+        unsigned mask = special(str);
+
+        if (mask != 0)
+        {
+            return str + simd_ctz(mask);
+        }
+        str += SIMD_WIDTH;
+    }
+#endif
+    while ((str < end) && !is_special((unsigned char)*str))
+    {
+        str++;
+    }
+    return str;
+}
+
+static int is_group(char c)
+{
+    return (c == '{') || (c == '}') || (c == '[') || (c == ']') || (c == '"');
+}
+
+const char *simd_find_group(const char *str, const char *end)
+{
+#if defined(SIMD_WIDTH)
+    while (end - str >= SIMD_WIDTH)
+    {
+        unsigned mask = group(str);
+
+        if (mask != 0)
+        {
+            return str + simd_ctz(mask);
+        }
+        str += SIMD_WIDTH;
+    }
+#endif
+    while ((str < end) && !is_group(*str))
+    {
+        str++;
+    }
+    return str;
+}
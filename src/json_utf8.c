@@ -0,0 +1,306 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "json_utf8.h"
+#include "json_simd.h"
+#include "json_macros.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define UTF8_WIDTH 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UTF8_WIDTH 16
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+static unsigned popcount(unsigned mask)
+{
+#if defined(__GNUC__)
+    return (unsigned)__builtin_popcount(mask);
+#else
+    unsigned count = 0;
+
+    for (; mask != 0; mask &= mask - 1)
+    {
+        count++;
+    }
+    return count;
+#endif
+}
+#endif
+
+/* Skips a run of ASCII characters */
+static const char *skip_ascii(const char *str, const char *end)
+{
+#if defined(__SSE2__)
+    while (end - str >= 16)
+    {
+        __m128i chr = _mm_loadu_si128((const __m128i *)(const void *)str);
+        int mask = _mm_movemask_epi8(chr);
+
+        if (mask != 0)
+        {
+            return str + simd_ctz((unsigned)mask);
+        }
+        str += 16;
+    }
+#endif
+    while ((str < end) && ((unsigned char)*str < 0x80))
+    {
+        str++;
+    }
+    return str;
+}
+
+/* Well-formed sequences as in table 3-7 of the Unicode standard */
+static const char *validate(const char *str, const char *end)
+{
+    while ((str = skip_ascii(str, end)) < end)
+    {
+        unsigned char c = (unsigned char)*str;
+        unsigned char min = 0x80, max = 0xbf;
+        ptrdiff_t size;
+
+        if ((c >= 0xc2) && (c <= 0xdf))
+        {
+            size = 2;
+        }
+        else if ((c >= 0xe0) && (c <= 0xef))
+        {
+            min = c == 0xe0 ? 0xa0 : 0x80;
+            max = c == 0xed ? 0x9f : 0xbf;
+            size = 3;
+        }
+        else if ((c >= 0xf0) && (c <= 0xf4))
+        {
+            min = c == 0xf0 ? 0x90 : 0x80;
+            max = c == 0xf4 ? 0x8f : 0xbf;
+            size = 4;
+        }
+        else
+        {
+            return str;
+        }
+        if (end - str < size)
+        {
+            return str;
+        }
+        c = (unsigned char)str[1];
+        if ((c < min) || (c > max))
+        {
+            return str;
+        }
+        for (ptrdiff_t i = 2; i < size; i++)
+        {
+            if ((str[i] & 0xc0) != 0x80)
+            {
+                return str;
+            }
+        }
+        str += size;
+    }
+    return str;
+}
+
+#if defined(__AVX2__)
+
+/*
+ * Lookup algorithm of Keiser and Lemire, "Validating UTF-8 in less than
+ * one instruction per byte", the high and the low nibble of each byte
+ * and the high nibble of the next one index three tables of error bits,
+ * a sequence is malformed when the three lookups share a bit
+ */
+
+enum
+{
+    TOO_SHORT = 1 << 0,         // 11______ 0_______, 11______ 11______
+    TOO_LONG = 1 << 1,          // 0_______ 10______
+    OVERLONG_3 = 1 << 2,        // 11100000 100_____
+    TOO_LARGE = 1 << 3,         // 11110100 1001____, 11110101+ 1001____
+    SURROGATE = 1 << 4,         // 11101101 101_____
+    OVERLONG_2 = 1 << 5,        // 1100000_ 10______
+    TOO_LARGE_1000 = 1 << 6,    // 11110101+ 1000____
+    OVERLONG_4 = 1 << 6,        // 11110000 1000____
+    TWO_CONTS = 1 << 7,         // 10______ 10______
+    CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS,
+};
+
+static const uint8_t byte_1_high[16] =
+{
+    /* ASCII */
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    /* Continuation */
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    /* Leading bytes */
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+static const uint8_t byte_1_low[16] =
+{
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+static const uint8_t byte_2_high[16] =
+{
+    /* ASCII */
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    /* Continuation */
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+    OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    /* Leading bytes */
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+#define load(str) _mm256_loadu_si256((const __m256i *)(const void *)(str))
+#define nibble(v) _mm256_and_si256((v), _mm256_set1_epi8(0x0f))
+/* Bytes of input shifted n positions, the first ones taken from prev */
+#define shift(input, prev, n) _mm256_alignr_epi8((input), \
+    _mm256_permute2x128_si256((prev), (input), 0x21), 16 - (n))
+
+static __m256i lookup(const uint8_t *table, __m256i index)
+{
+    __m128i row = _mm_loadu_si128((const __m128i *)(const void *)table);
+
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(row), index);
+}
+
+typedef struct
+{
+    __m256i error, prev, incomplete;
+} utf8_state;
+
+static void check(utf8_state *state, __m256i input)
+{
+    if (_mm256_movemask_epi8(input) == 0)
+    {
+        /* ASCII, a sequence can not be left open in the last block */
+        state->error = _mm256_or_si256(state->error, state->incomplete);
+        state->incomplete = _mm256_setzero_si256();
+        state->prev = input;
+        return;
+    }
+
+    __m256i prev1 = shift(input, state->prev, 1);
+    __m256i bits = _mm256_and_si256(
+        _mm256_and_si256(
+            lookup(byte_1_high, nibble(_mm256_srli_epi16(prev1, 4))),
+            lookup(byte_1_low, nibble(prev1))
+        ),
+        lookup(byte_2_high, nibble(_mm256_srli_epi16(input, 4)))
+    );
+    /* Third and fourth bytes of 3 and 4 byte sequences */
+    __m256i third = _mm256_subs_epu8(shift(input, state->prev, 2),
+        _mm256_set1_epi8((char)(0xe0 - 0x80))
+    );
+    __m256i fourth = _mm256_subs_epu8(shift(input, state->prev, 3),
+        _mm256_set1_epi8((char)(0xf0 - 0x80))
+    );
+    __m256i must = _mm256_and_si256(_mm256_or_si256(third, fourth),
+        _mm256_set1_epi8((char)0x80)
+    );
+
+    state->error = _mm256_or_si256(state->error,
+        _mm256_xor_si256(must, bits)
+    );
+    /* Leading bytes at the end of the block */
+    state->incomplete = _mm256_subs_epu8(input, _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1))
+    );
+    state->prev = input;
+}
+
+static int is_valid(const char *str, const char *end)
+{
+    utf8_state state =
+    {
+        _mm256_setzero_si256(), _mm256_setzero_si256(),
+        _mm256_setzero_si256()
+    };
+
+    for (; end - str >= UTF8_WIDTH; str += UTF8_WIDTH)
+    {
+        check(&state, load(str));
+    }
+
+    /* Padding with '\0' closes the sequences left open */
+    char tail[UTF8_WIDTH] = {0};
+
+    memcpy(tail, str, (size_t)(end - str));
+    check(&state, load(tail));
+    return _mm256_testz_si256(state.error, state.error);
+}
+
+#endif
+
+const char *utf8_validate(const char *str, const char *end)
+{
+#if defined(__AVX2__)
+    /* Look for the position only when the text is malformed */
+    if (is_valid(str, end))
+    {
+        return end;
+    }
+#endif
+    return validate(str, end);
+}
+
+size_t utf8_length(const char *str, size_t length)
+{
+    const char *end = str + length;
+    size_t count = length;
+
+    /* Count the continuation bytes (0x80 to 0xbf) */
+#if defined(__AVX2__)
+    for (; end - str >= UTF8_WIDTH; str += UTF8_WIDTH)
+    {
+        __m256i chr = load(str);
+        __m256i cont = _mm256_cmpgt_epi8(_mm256_set1_epi8(-0x40), chr);
+
+        count -= popcount((unsigned)_mm256_movemask_epi8(cont));
+    }
+#elif defined(__SSE2__)
+    for (; end - str >= UTF8_WIDTH; str += UTF8_WIDTH)
+    {
+        __m128i chr = _mm_loadu_si128((const __m128i *)(const void *)str);
+        __m128i cont = _mm_cmpgt_epi8(_mm_set1_epi8(-0x40), chr);
+
+        count -= popcount((unsigned)_mm_movemask_epi8(cont));
+    }
+#endif
+    for (; str < end; str++)
+    {
+        count -= !is_utf8(*str);
+    }
+    return count;
+}
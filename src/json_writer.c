@@ -59,21 +59,26 @@ static json_buffer *buffer_write(json_buffer *buffer, const char *text)
     return buffer_write_sized(buffer, text, strlen(text));
 }
 
-static json_buffer *buffer_write_integer(json_buffer *buffer, double value)
+static json_buffer *buffer_write_integer(json_buffer *buffer,
+    const json *node)
 {
-    size_t length = (size_t)snprintf(NULL, 0, "%.0f", value);
-    size_t size = buffer->length + length + 1;
-
-    if (size > buffer->size)
+    /* Room for UINT64_MAX or INT64_MIN */
+    char text[24] = "";
+    char *end = text + sizeof text - 1;
+    char *ptr = end;
+    int negative = !(node->flags & JSON_UNSIGNED) && (node->value.integer < 0);
+    uint64_t value = negative ? 0 - node->value.real : node->value.real;
+
+    do
     {
-        if (!buffer_resize(buffer, buffer_next_size(size)))
-        {
-            return NULL;
-        }
+        *--ptr = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    if (negative)
+    {
+        *--ptr = '-';
     }
-    snprintf(buffer->text + buffer->length, length + 1, "%.0f", value);
-    buffer->length += length;
-    return buffer;
+    return buffer_write_sized(buffer, ptr, (size_t)(end - ptr));
 }
 
 static json_buffer *buffer_write_double(json_buffer *buffer, double value)
@@ -153,10 +158,18 @@ static int buffer_print(json_buffer *buffer, const json *node)
             CHECK(buffer_quote(buffer, node->value.string));
             return 1;
         case JSON_INTEGER:
-            CHECK(buffer_write_integer(buffer, node->value.number));
+            CHECK(buffer_write_integer(buffer, node));
             return 1;
         case JSON_DOUBLE:
-            CHECK(buffer_write_double(buffer, node->value.number));
+            /* Digits of the text (JSON_PARSE_LAZY) */
+            if (node->flags & JSON_NUMBER_TEXT)
+            {
+                CHECK(buffer_write(buffer, node->value.string));
+            }
+            else
+            {
+                CHECK(buffer_write_double(buffer, node->value.number));
+            }
             return 1;
         case JSON_BOOLEAN:
             CHECK(buffer_write(buffer, node->value.number != 0 ? "true" : "false"));
@@ -169,16 +182,27 @@ static int buffer_print(json_buffer *buffer, const json *node)
     }
 }
 
-static int buffer_write_node(json_buffer *buffer, const json *node, int depth)
+/* A compact tree is written in a single line without spaces */
+static int buffer_indent(json_buffer *buffer, int depth, int compact)
 {
-    for (int i = 0; i < depth; i++)
+    if (!compact)
     {
-        CHECK(buffer_write(buffer, "  "));
+        for (int i = 0; i < depth; i++)
+        {
+            CHECK(buffer_write(buffer, "  "));
+        }
     }
+    return 1;
+}
+
+static int buffer_write_node(json_buffer *buffer, const json *node, int depth,
+    int compact)
+{
+    CHECK(buffer_indent(buffer, depth, compact));
     if (node->name != NULL)
     {
         CHECK(buffer_quote(buffer, node->name));
-        CHECK(buffer_write(buffer, ": "));
+        CHECK(buffer_write(buffer, compact ? ":" : ": "));
     }
     switch (node->type)
     {
@@ -211,19 +235,20 @@ static int buffer_write_node(json_buffer *buffer, const json *node, int depth)
             CHECK(buffer_write(buffer, ","));
         }
     }
-    CHECK(buffer_write(buffer, "\n"));
+    if (!compact)
+    {
+        CHECK(buffer_write(buffer, "\n"));
+    }
     return 1;
 }
 
-static int buffer_write_next(json_buffer *buffer, const json *node, int depth)
+static int buffer_write_next(json_buffer *buffer, const json *node, int depth,
+    int compact)
 {
     /* if "array" or "object" */
     if (node->child != NULL)
     {
-        for (int i = 0; i < depth; i++)
-        {
-            CHECK(buffer_write(buffer, "  "));
-        }
+        CHECK(buffer_indent(buffer, depth, compact));
         switch (node->type)
         {
             case JSON_OBJECT:
@@ -239,18 +264,21 @@ static int buffer_write_next(json_buffer *buffer, const json *node, int depth)
         {
            CHECK(buffer_write(buffer, ","));
         }
-        CHECK(buffer_write(buffer, "\n"));
+        if (!compact)
+        {
+            CHECK(buffer_write(buffer, "\n"));
+        }
     }
     return 1;
 }
 
-static int buffer_encode(json_buffer *buffer, const json *node)
+static int buffer_encode(json_buffer *buffer, const json *node, int compact)
 {
     int depth = 0;
 
     while (node != NULL)
     {
-        if (!buffer_write_node(buffer, node, depth))
+        if (!buffer_write_node(buffer, node, depth, compact))
         {
             return 0;
         }
@@ -268,7 +296,7 @@ static int buffer_encode(json_buffer *buffer, const json *node)
             while (depth-- > 0)
             {
                 node = node->parent;
-                if (!buffer_write_next(buffer, node, depth))
+                if (!buffer_write_next(buffer, node, depth, compact))
                 {
                     return 0;
                 }
@@ -292,7 +320,7 @@ char *json_encode(const json *node)
     json_buffer buffer = {NULL, 0, 0};
     char *text = NULL;
 
-    if (buffer_encode(&buffer, node))
+    if (buffer_encode(&buffer, node, 0))
     {
         text = buffer.text;
     }
@@ -339,6 +367,25 @@ int json_write(const json *node, FILE *file)
     return rc;
 }
 
+/* Writes a tree in a single line (NDJSON / JSON Lines) */
+int json_write_line(const json *node, FILE *file)
+{
+    if (node == NULL)
+    {
+        return 0;
+    }
+
+    json_buffer buffer = {NULL, 0, 0};
+    int rc = 0;
+
+    if (buffer_encode(&buffer, node, 1) && buffer_write(&buffer, "\n"))
+    {
+        rc = fwrite(buffer.text, 1, buffer.length, file) == buffer.length;
+    }
+    free(buffer.text);
+    return rc;
+}
+
 int json_print(const json *node)
 {
     return json_write(node, stdout);
@@ -398,3 +445,187 @@ char *json_path(const json *node)
     return text;
 }
 
+/* Reads an integer member of a bound struct (see json_bind.c) */
+static int bind_integer(json *node, const json_field *field,
+    const char *data)
+{
+    int is_signed = field->type == JSON_BIND_INTEGER;
+    const void *ptr = data;
+
+    switch (field->size)
+    {
+        case sizeof(int8_t):
+            if (is_signed)
+            {
+                node->value.integer = *(const int8_t *)ptr;
+            }
+            else
+            {
+                node->value.integer = *(const uint8_t *)ptr;
+            }
+            break;
+        case sizeof(int16_t):
+            if (is_signed)
+            {
+                node->value.integer = *(const int16_t *)ptr;
+            }
+            else
+            {
+                node->value.integer = *(const uint16_t *)ptr;
+            }
+            break;
+        case sizeof(int32_t):
+            if (is_signed)
+            {
+                node->value.integer = *(const int32_t *)ptr;
+            }
+            else
+            {
+                node->value.integer = *(const uint32_t *)ptr;
+            }
+            break;
+        case sizeof(int64_t):
+            node->value.integer = *(const int64_t *)ptr;
+            if (!is_signed && (node->value.integer < 0))
+            {
+                node->flags = JSON_UNSIGNED;
+            }
+            break;
+        default:
+            return 0;
+    }
+    node->type = JSON_INTEGER;
+    return 1;
+}
+
+static int buffer_bind_value(json_buffer *, const json_field *,
+    const char *);
+
+static int buffer_bind_array(json_buffer *buffer, const json_field *field,
+    const char *data)
+{
+    const json_field *element = field->fields;
+    size_t count = *(const size_t *)(const void *)(data - field->offset +
+        field->count
+    );
+
+    if ((field->name == NULL) || (count > field->size / element->size))
+    {
+        return 0;
+    }
+    CHECK(buffer_write(buffer, "["));
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            CHECK(buffer_write(buffer, ","));
+        }
+        CHECK(buffer_bind_value(buffer, element, data + i * element->size));
+    }
+    CHECK(buffer_write(buffer, "]"));
+    return 1;
+}
+
+static int buffer_bind_object(json_buffer *buffer, const json_field *fields,
+    const char *data)
+{
+    CHECK(buffer_write(buffer, "{"));
+    for (const json_field *field = fields; field->name != NULL; field++)
+    {
+        if (field != fields)
+        {
+            CHECK(buffer_write(buffer, ","));
+        }
+        CHECK(buffer_quote(buffer, field->name));
+        CHECK(buffer_write(buffer, ":"));
+        CHECK(buffer_bind_value(buffer, field, data + field->offset));
+    }
+    CHECK(buffer_write(buffer, "}"));
+    return 1;
+}
+
+static int buffer_bind_value(json_buffer *buffer, const json_field *field,
+    const char *data)
+{
+    json node = {0};
+
+    switch (field->type)
+    {
+        case JSON_BIND_INTEGER:
+        case JSON_BIND_UNSIGNED:
+            CHECK(bind_integer(&node, field, data));
+            CHECK(buffer_write_integer(buffer, &node));
+            break;
+        case JSON_BIND_DOUBLE:
+            if (field->size == sizeof(float))
+            {
+                CHECK(buffer_write_double(buffer,
+                    *(const float *)(const void *)data)
+                );
+            }
+            else if (field->size == sizeof(double))
+            {
+                CHECK(buffer_write_double(buffer,
+                    *(const double *)(const void *)data)
+                );
+            }
+            else
+            {
+                return 0;
+            }
+            break;
+        case JSON_BIND_BOOLEAN:
+            CHECK(bind_integer(&node, field, data));
+            CHECK(buffer_write(buffer, node.value.real ? "true" : "false"));
+            break;
+        case JSON_BIND_STRING:
+        {
+            const char *str = *(char * const *)(const void *)data;
+
+            if (str == NULL)
+            {
+                CHECK(buffer_write(buffer, "null"));
+            }
+            else
+            {
+                CHECK(buffer_quote(buffer, str));
+            }
+            break;
+        }
+        case JSON_BIND_CHARS:
+            CHECK(memchr(data, '\0', field->size) != NULL);
+            CHECK(buffer_quote(buffer, data));
+            break;
+        case JSON_BIND_OBJECT:
+            CHECK(buffer_bind_object(buffer, field->fields, data));
+            break;
+        case JSON_BIND_ARRAY:
+            CHECK(buffer_bind_array(buffer, field, data));
+            break;
+        default:
+            return 0;
+    }
+    return 1;
+}
+
+/* Encodes a struct described by fields, the inverse of json_bind */
+char *json_bind_encode(const json_field *fields, const void *object)
+{
+    if ((fields == NULL) || (object == NULL))
+    {
+        return NULL;
+    }
+
+    json_buffer buffer = {NULL, 0, 0};
+    char *text = NULL;
+
+    if (buffer_bind_object(&buffer, fields, object))
+    {
+        text = buffer.text;
+    }
+    else
+    {
+        free(buffer.text);
+    }
+    return text;
+}
@@ -0,0 +1,47 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * Parsing with JSON_PARSE_ARENA
+ * -----------------------------
+ * Nodes, names and strings are allocated in a single arena owned by the
+ * document, json_free() releases the whole arena at once.
+ * The builder still works on arena trees, but nodes popped from a
+ * document must not outlive it.
+ */
+
+#include <json/json.h>
+
+int main(void)
+{
+    const char *text = "{\"id\": 1, \"tags\": [\"a\", \"b\"], \"user\": null}";
+    json_options options = {.flags = JSON_PARSE_ARENA};
+    json_error error;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        json *node = json_parse_options(text, &options, &error);
+
+        if (node == NULL)
+        {
+            json_print_error(NULL, &error);
+            return 0;
+        }
+        json_free(node);
+    }
+
+    json *node = json_parse_options(text, &options, &error);
+
+    if (node != NULL)
+    {
+        // Heap nodes pushed into an arena tree are released by json_free()
+        json_push_back(json_find(node, "tags"), json_new_string(NULL, "c"));
+        json_set_string(json_find(node, "user"), "root");
+        json_print(node);
+        json_free(node);
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * Binding json to C structs
+ * -------------------------
+ * json_bind() fills a struct described by an array of json_field from a
+ * json text without building a tree, json_bind_encode() does the reverse.
+ * Strings are allocated by json_bind and released by json_bind_free.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <json/json.h>
+
+typedef struct
+{
+    char *street;
+    char zip[8];
+} address;
+
+typedef struct
+{
+    int id;
+    char *name;
+    double balance;
+    bool active;
+    address home;
+    unsigned scores[4];
+    size_t count;
+} customer;
+
+static const json_field address_fields[] =
+{
+    JSON_FIELD(address, street, JSON_BIND_STRING),
+    JSON_FIELD(address, zip, JSON_BIND_CHARS),
+    JSON_FIELD_END
+};
+
+static const json_field score = JSON_ELEMENT(unsigned, JSON_BIND_UNSIGNED,
+    NULL
+);
+
+static const json_field customer_fields[] =
+{
+    JSON_FIELD(customer, id, JSON_BIND_INTEGER),
+    JSON_FIELD(customer, name, JSON_BIND_STRING),
+    JSON_FIELD(customer, balance, JSON_BIND_DOUBLE),
+    JSON_FIELD(customer, active, JSON_BIND_BOOLEAN),
+    JSON_FIELD_OBJECT(customer, home, address_fields),
+    JSON_FIELD_ARRAY(customer, scores, &score, count),
+    JSON_FIELD_END
+};
+
+int main(void)
+{
+    const char *text =
+        "{\"id\": 7, \"name\": \"Ada\", \"balance\": 12.5, \"active\": true,"
+        " \"home\": {\"street\": \"Main St\", \"zip\": \"08001\"},"
+        " \"scores\": [9, 7, 10], \"notes\": [\"ignored\"]}";
+    customer data = {0};
+    json_error error;
+
+    if (!json_bind(text, customer_fields, &data, &error))
+    {
+        json_print_error(NULL, &error);
+        return 0;
+    }
+    printf("%s (%d) lives at %s, %zu scores\n",
+        data.name, data.id, data.home.street, data.count
+    );
+
+    char *str = json_bind_encode(customer_fields, &data);
+
+    if (str != NULL)
+    {
+        puts(str);
+        free(str);
+    }
+    json_bind_free(customer_fields, &data);
+    // A value of a wrong type
+    const char *wrong = "{\"id\": \"7\"}";
+
+    if (!json_bind(wrong, customer_fields, &data, &error))
+    {
+        // Line and column are computed on demand
+        json_error_locate(&error, wrong);
+        json_print_error(NULL, &error);
+    }
+    return 0;
+}
@@ -18,34 +18,23 @@ CFLAGS="-std=c11 -Wpedantic -Wall -Wextra -O2" LDLIBS="-lcurl -ljson" make demo
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 #include <curl/curl.h>
 #include <json/json.h>
 
-struct string
+/* The response is parsed as it arrives, chunk by chunk */
+static size_t parser_feed(void *ptr, size_t size, size_t nmemb, void *stream)
 {
-    char *data;
-    size_t len;
-};
+    json_parser *parser = stream;
 
-static size_t string_read(void *ptr, size_t size, size_t nmemb, void *stream)
-{
-    struct string *str = stream;
-    size_t len = str->len + size * nmemb;
-
-    str->data = realloc(str->data, len + 1);
-    if (str->data == NULL)
+    if (!json_parser_feed(parser, ptr, size * nmemb))
     {
-        perror("realloc");
-        exit(EXIT_FAILURE);
+        /* Abort the transfer */
+        return 0;
     }
-    memcpy(str->data + str->len, ptr, size * nmemb);
-    str->data[len] = '\0';
-    str->len = len;
     return size * nmemb;
 }
 
-static size_t url_read(struct string *str)
+static int url_read(json_parser *parser)
 {
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
@@ -64,28 +53,29 @@ static size_t url_read(struct string *str)
         curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
         curl_easy_setopt(curl, CURLOPT_URL,
             "https://official-joke-api.appspot.com/random_joke");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, string_read);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, str);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, parser_feed);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, parser);
         res = curl_easy_perform(curl);
         curl_easy_cleanup(curl);
     }
     curl_slist_free_all(headers);
     curl_global_cleanup();
-    return (res == CURLE_OK) ? str->len : 0;
+    return res == CURLE_OK;
 }
 
 int main(void)
 {
-    struct string str = {0};
+    json_parser *parser = json_parser_create(NULL);
 
-    if (url_read(&str) == 0)
+    if (parser == NULL)
     {
-        perror("url_read");
+        perror("json_parser_create");
         exit(EXIT_FAILURE);
     }
 
     json_error error;
-    json *node = json_parse(str.data, &error);
+    int done = url_read(parser);
+    json *node = json_parser_finish(parser, &error);
 
     if (node != NULL)
     {
@@ -95,12 +85,14 @@ int main(void)
         );
         json_free(node);
     }
-    else
+    else if (done)
     {
         json_print_error(NULL, &error);
-        puts(str.data);
     }
-    free(str.data);
+    else
+    {
+        perror("url_read");
+    }
+    json_parser_destroy(parser);
     return 0;
 }
-
@@ -0,0 +1,57 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * On-demand access with a cursor
+ * ------------------------------
+ * A cursor walks the text without building nodes, values not visited
+ * are skipped by bracket matching and they are not validated.
+ * json_cursor_value() builds a tree with the value under the cursor.
+ */
+
+#include <string.h>
+#include <json/json.h>
+
+int main(void)
+{
+    const char *text =
+        "{\"id\": 42, \"user\": {\"name\": \"Alice\", \"roles\": [\"a\", \"b\"]},"
+        " \"items\": [{\"price\": 9.5}, {\"price\": 2.25}], \"ok\": true}";
+    json_cursor root, cursor, item;
+
+    if (!json_cursor_init(&root, text, strlen(text)))
+    {
+        return 0;
+    }
+    if (json_cursor_find(&root, "id", &cursor))
+    {
+        printf("id: %lld\n", json_cursor_integer(&cursor));
+    }
+    if (json_cursor_find(&root, "items", &cursor) &&
+        json_cursor_child(&cursor, &item))
+    {
+        double total = 0;
+
+        do
+        {
+            json_cursor price;
+
+            if (json_cursor_find(&item, "price", &price))
+            {
+                total += json_cursor_double(&price);
+            }
+        } while (json_cursor_next(&item));
+        printf("total: %g\n", total);
+    }
+    if (json_cursor_find(&root, "user", &cursor))
+    {
+        json *user = json_cursor_value(&cursor);
+
+        json_print(user);
+        json_free(user);
+    }
+    return 0;
+}
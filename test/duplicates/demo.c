@@ -0,0 +1,78 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * Repeated names in an object
+ * ---------------------------
+ * JSON_PARSE_UNIQUE rejects an object with a repeated name, while
+ * JSON_PARSE_KEEP_FIRST and JSON_PARSE_KEEP_LAST keep a single member.
+ * Names are compared once unescaped ("k\u0031" is "k1"), the first members
+ * are searched linearly and the names of a wide object are hashed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <json/json.h>
+
+static void parse(const char *title, const char *text, unsigned flags,
+    int insitu)
+{
+    json_options options = {.flags = flags};
+    json_error error;
+    json *node = NULL;
+    char *copy = NULL;
+
+    printf("%s%s:\n", title, insitu ? " (in-situ)" : "");
+    if (insitu)
+    {
+        size_t size = strlen(text) + 1;
+
+        if ((copy = malloc(size)) == NULL)
+        {
+            return;
+        }
+        node = json_parse_insitu(memcpy(copy, text, size), &options, &error);
+    }
+    else
+    {
+        node = json_parse_options(text, &options, &error);
+    }
+    if (node == NULL)
+    {
+        json_error_locate(&error, text);
+        json_print_error(NULL, &error);
+    }
+    else
+    {
+        json_write_line(node, stdout);
+        json_free(node);
+    }
+    // Names and strings of an in-situ tree point into the buffer
+    free(copy);
+}
+
+int main(void)
+{
+    // A small object and a wide one, past the members searched linearly
+    const char *texts[] =
+    {
+        "{\"a\": 1, \"b\": 2, \"a\": 3}",
+        "{\"k0\": 0, \"k1\": 1, \"k2\": 2, \"k3\": 3, \"k4\": 4, \"k5\": 5,"
+        " \"k6\": 6, \"k7\": 7, \"k8\": 8, \"k9\": 9, \"k10\": 10,"
+        " \"k\\u0031\": \"k1 again\", \"k10\": \"k10 again\"}"
+    };
+
+    for (size_t i = 0; i < sizeof texts / sizeof *texts; i++)
+    {
+        for (int insitu = 0; insitu < 2; insitu++)
+        {
+            parse("Unique", texts[i], JSON_PARSE_UNIQUE, insitu);
+            parse("Keep first", texts[i], JSON_PARSE_KEEP_FIRST, insitu);
+            parse("Keep last", texts[i], JSON_PARSE_KEEP_LAST, insitu);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * Event parsing
+ * -------------
+ * json_parse_events() doesn't build a tree, it sends every key, scalar and
+ * start/end of group to a callback instead.
+ * The node passed to the callback is reused by the parser, it's only valid
+ * during the call, but it can be read with the usual functions:
+ * json_key(), json_string(), json_number(), json_depth() ...
+ *
+ * Return from the callback:
+ * <= 0 to stop parsing
+ *  > 0 to continue
+ */
+
+#include <string.h>
+#include <json/json.h>
+
+struct stats
+{
+    int objects, arrays, strings;
+    double total;
+};
+
+static int on_event(enum json_event event, const json *node, void *data)
+{
+    struct stats *stats = data;
+
+    switch (event)
+    {
+        case JSON_EVENT_START_OBJECT:
+            stats->objects++;
+            break;
+        case JSON_EVENT_START_ARRAY:
+            stats->arrays++;
+            break;
+        case JSON_EVENT_STRING:
+            stats->strings++;
+            break;
+        case JSON_EVENT_NUMBER:
+            // Sum prices only
+            if (json_key(node) && !strcmp(json_key(node), "price"))
+            {
+                stats->total += json_number(node);
+            }
+            break;
+        default:
+            break;
+    }
+    return 1;
+}
+
+int main(void)
+{
+    const char *text =
+        "{\"items\": ["
+        "{\"name\": \"pen\", \"price\": 1.25, \"tags\": [\"office\"]},"
+        "{\"name\": \"book\", \"price\": 12.5, \"tags\": []}"
+        "]}";
+    struct stats stats = {0};
+    json_error error;
+
+    if (json_parse_events(text, on_event, &stats, &error) == -1)
+    {
+        json_print_error(NULL, &error);
+        return 0;
+    }
+    printf("Objects: %d, arrays: %d, strings: %d, total price: %.2f\n",
+        stats.objects, stats.arrays, stats.strings, stats.total
+    );
+    return 0;
+}
@@ -0,0 +1,32 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * In-situ parsing
+ * ---------------
+ * json_parse_insitu() unescapes names and strings in place inside the
+ * buffer passed by the caller, nodes point into that buffer instead of
+ * owning a copy, so the buffer must outlive the tree.
+ * The buffer is left intact if the parse fails.
+ */
+
+#include <json/json.h>
+
+int main(void)
+{
+    char text[] = "{\"name\": \"caf\\u00e9\", \"tags\": [\"a\\tb\", \"c\"]}";
+    json_error error;
+    json *node = json_parse_insitu(text, NULL, &error);
+
+    if (node == NULL)
+    {
+        json_print_error(NULL, &error);
+        return 0;
+    }
+    json_print(node);
+    json_free(node);
+    return 0;
+}
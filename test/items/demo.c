@@ -0,0 +1,45 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * Reading the elements of a huge array
+ * ------------------------------------
+ * json_items_read() returns the elements of a top-level array one by one,
+ * the file is read in windows, the memory used is bounded by the largest
+ * element. The tree is owned by the reader and recycled by the next call.
+ */
+
+#include <json/json.h>
+
+int main(void)
+{
+    FILE *file = fopen("test.json", "rb");
+
+    if (file == NULL)
+    {
+        json_print_error("test.json", NULL);
+        return 0;
+    }
+
+    json_items *items = json_items_open(file);
+    json_error error;
+    json *node;
+
+    while ((node = json_items_read(items, &error)))
+    {
+        printf("%zu: %s\n", json_items_count(items),
+            json_string(json_find(node, "name"))
+        );
+    }
+    // Reading stops at the first error
+    if (error.code != JSON_ERROR_NONE)
+    {
+        json_print_error("test.json", &error);
+    }
+    json_items_close(items);
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * Reading and writing NDJSON (JSON Lines)
+ * ---------------------------------------
+ * json_lines_read() returns one tree per line, the tree is owned by the
+ * reader and its memory is recycled by the next call.
+ * json_write_line() writes a tree in a single line.
+ */
+
+#include <json/json.h>
+
+int main(void)
+{
+    FILE *file = fopen("test.ndjson", "rb");
+
+    if (file == NULL)
+    {
+        json_print_error("test.ndjson", NULL);
+        return 0;
+    }
+
+    json_lines *lines = json_lines_open(file);
+    json_error error;
+
+    while (1)
+    {
+        json *node = json_lines_read(lines, &error);
+
+        if (node != NULL)
+        {
+            json_write_line(node, stdout);
+        }
+        else if (error.code != JSON_ERROR_NONE)
+        {
+            // Malformed records can be skipped
+            fprintf(stderr, "Record %zu: ", json_lines_record(lines));
+            json_print_error("test.ndjson", &error);
+        }
+        else
+        {
+            break;
+        }
+    }
+    json_lines_close(lines);
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * Parsing a large document on several threads
+ * -------------------------------------------
+ * json_parse_parallel() cuts the top-level group in slices parsed on
+ * their own threads, the tree and the errors must be the same than the
+ * ones of json_parse_options(). Strings with commas, brackets and escaped
+ * quotes make sure that the cuts are not made inside a string.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <json/json.h>
+
+#define ELEMENTS 50000
+#define THREADS 4
+
+static char *build(const char *broken, int trailing)
+{
+    size_t size = ELEMENTS * 128;
+    char *text = malloc(size);
+    size_t length = 0;
+
+    if (text == NULL)
+    {
+        return NULL;
+    }
+    text[length++] = '[';
+    for (int i = 0; i < ELEMENTS; i++)
+    {
+        // A malformed element in the middle of the text
+        if ((broken != NULL) && (i == ELEMENTS / 2))
+        {
+            length += (size_t)snprintf(text + length, size - length,
+                "%s,\n", broken
+            );
+            continue;
+        }
+        length += (size_t)snprintf(text + length, size - length,
+            "{\"id\": %d, \"text\": \"a, [b] \\\"{c}\\\"\","
+            " \"n\": [%d.5, true]}%s\n",
+            i, i, (i < ELEMENTS - 1) || trailing ? "," : ""
+        );
+    }
+    text[length++] = ']';
+    text[length] = '\0';
+    return text;
+}
+
+static void compare(const char *title, const char *text,
+    const json_options *options)
+{
+    json_error error1, error2;
+    json *node1 = json_parse_options(text, options, &error1);
+    json *node2 = json_parse_parallel(text, options, THREADS, &error2);
+
+    if ((node1 != NULL) && (node2 != NULL))
+    {
+        printf("%s: %s (%zu elements)\n", title,
+            json_equal(node1, node2) ? "same tree" : "different trees",
+            json_size(node2)
+        );
+    }
+    else if ((node1 == NULL) && (node2 == NULL))
+    {
+        printf("%s: %s (error at offset %zu)\n", title,
+            error1.offset == error2.offset ? "same error" : "different errors",
+            error2.offset
+        );
+    }
+    else
+    {
+        printf("%s: only one of the parsers failed\n", title);
+    }
+    json_free(node1);
+    json_free(node2);
+}
+
+int main(void)
+{
+    json_options arena = {.flags = JSON_PARSE_ARENA};
+    char *text;
+
+    if ((text = build(NULL, 0)))
+    {
+        compare("Heap", text, NULL);
+        compare("Arena", text, &arena);
+        free(text);
+    }
+    if ((text = build("{\"id\": 0, \"text\": \"x\",}", 0)))
+    {
+        compare("Malformed element", text, NULL);
+        free(text);
+    }
+    if ((text = build(NULL, 1)))
+    {
+        compare("Trailing comma", text, NULL);
+        free(text);
+    }
+    if ((text = build("", 0)))
+    {
+        compare("Empty element", text, NULL);
+        free(text);
+    }
+    return 0;
+}
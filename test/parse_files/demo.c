@@ -0,0 +1,56 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * Parsing a list of files
+ * -----------------------
+ * json_parse_files() reads the files through io_uring when available and
+ * parses them on a pool of threads, the trees are returned in a map keyed
+ * by path. A file that can not be read (JSON_ERROR_READ) or parsed is not
+ * in the map, a path repeated in the list is parsed once.
+ */
+
+#include <json/json.h>
+#include <json/json_map.h>
+
+int main(void)
+{
+    const char *paths[] =
+    {
+        "first.json", "missing.json", "second.json", "broken.json",
+        "first.json"
+    };
+    enum {N = sizeof paths / sizeof *paths};
+    json_ingest_options options = {.threads = 2};
+    json_error errors[N];
+    json_map *map = json_parse_files(paths, N, &options, errors);
+
+    if (map == NULL)
+    {
+        json_print_error(NULL, NULL);
+        return 0;
+    }
+    printf("%zu files parsed\n", json_map_size(map));
+    for (size_t i = 0; i < N; i++)
+    {
+        json *node = json_map_search(map, paths[i]);
+
+        if (node != NULL)
+        {
+            printf("%s: %s\n", paths[i], json_string(json_find(node, "name")));
+        }
+        else if (errors[i].code == JSON_ERROR_READ)
+        {
+            printf("%s: can not be read\n", paths[i]);
+        }
+        else
+        {
+            json_print_error(paths[i], &errors[i]);
+        }
+    }
+    json_map_destroy(map, json_free);
+    return 0;
+}
@@ -0,0 +1,42 @@
+/*!
+ *  \brief     strictissimo - Ligtweight json and json-schema library for C
+ *  \author    David Ranieri <davranfor@gmail.com>
+ *  \copyright GNU Public License.
+ */
+
+/**
+ * Projection parsing
+ * ------------------
+ * Only the values on a set of pointers are built, the rest of the text
+ * is validated and skipped without allocating, "*" matches any member
+ * or element. The same pointers can be used on the projected tree,
+ * elements of an array skipped before a kept one are null.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <json/json.h>
+
+int main(void)
+{
+    const char *text =
+        "{\"id\": 42, \"user\": {\"id\": 7, \"name\": \"Alice\"},"
+        " \"items\": [{\"price\": 9.5, \"tags\": [\"a\"]}, {\"price\": 2.25}],"
+        " \"notes\": \"not needed\"}";
+    const char *pointers[] = {"/user/id", "/items/*/price"};
+    json_error error;
+    json *node = json_parse_projection(text, strlen(text), pointers, 2,
+        &error
+    );
+
+    if (node == NULL)
+    {
+        json_error_locate(&error, text);
+        json_print_error(NULL, &error);
+        return EXIT_FAILURE;
+    }
+    printf("user: %lld\n", json_integer(json_pointer(node, "/user/id")));
+    json_print(node);
+    json_free(node);
+    return 0;
+}